@@ -0,0 +1,181 @@
+// Times the DE_Statistics aggregation kernels against the per-dimension loop they replaced, on a synthetic matrix.
+//
+// Usage: ClusterStatisticsBenchmark [rows] [dimensions] [clusters] [density] [repetitions]
+
+#include "ClusterStatistics.h"
+#include "RowKernels.h"
+#include "SparseMatrix.h"
+
+#include <omp.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+    /** Stands in for the ManiVault Cluster, the kernels only read its indices */
+    struct Cluster
+    {
+        std::vector<std::uint32_t> indices;
+
+        const std::vector<std::uint32_t>& getIndices() const { return indices; }
+    };
+
+    /** Row view on a row-major array, like the views Points::visitData hands out */
+    struct PointView
+    {
+        const float* data;
+        std::size_t numDimensions;
+
+        const float* operator[](std::size_t row) const { return data + (row * numDimensions); }
+    };
+
+    std::vector<float> syntheticMatrix(std::size_t rows, std::size_t dimensions, double density)
+    {
+        std::vector<float> data(rows * dimensions, 0.0f);
+        const std::ptrdiff_t numRows = static_cast<std::ptrdiff_t>(rows);
+
+        #pragma omp parallel
+        {
+            std::mt19937 generator(1234 + omp_get_thread_num());
+            std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+            std::lognormal_distribution<float> expression(0.0f, 1.0f);
+
+            #pragma omp for schedule(static)
+            for (std::ptrdiff_t row = 0; row < numRows; ++row)
+            {
+                for (std::size_t dimension = 0; dimension < dimensions; ++dimension)
+                {
+                    if (uniform(generator) < density)
+                        data[(row * dimensions) + dimension] = expression(generator);
+                }
+            }
+        }
+        return data;
+    }
+
+    std::vector<Cluster> syntheticClusters(std::size_t rows, std::size_t numClusters)
+    {
+        std::vector<Cluster> clusters(numClusters);
+        std::mt19937 generator(42);
+        std::uniform_int_distribution<std::size_t> cluster(0, numClusters - 1);
+        for (std::size_t row = 0; row < rows; ++row)
+            clusters[cluster(generator)].indices.push_back(static_cast<std::uint32_t>(row));
+        return clusters;
+    }
+
+    /** The aggregation as it was before the tiled kernels: one pass over the cluster members per dimension, means only */
+    std::vector<float> perDimensionMeans(const PointView& vec, const std::vector<Cluster>& clusters, std::size_t numDimensions)
+    {
+        const std::ptrdiff_t numClusters = static_cast<std::ptrdiff_t>(clusters.size());
+        std::vector<float> meanExpressions(numClusters * numDimensions, 0);
+
+        #pragma omp parallel for schedule(dynamic, 1)
+        for (std::ptrdiff_t dimension = 0; dimension < static_cast<std::ptrdiff_t>(numDimensions); ++dimension)
+        {
+            for (std::ptrdiff_t clusterIdx = 0; clusterIdx < numClusters; ++clusterIdx)
+            {
+                const auto& clusterIndices = clusters[clusterIdx].getIndices();
+                const std::size_t offset = (clusterIdx * numDimensions) + dimension;
+                for (auto row : clusterIndices)
+                    meanExpressions[offset] += vec[row][dimension];
+                meanExpressions[offset] /= clusterIndices.size();
+            }
+        }
+        return meanExpressions;
+    }
+
+    double maxDifference(const std::vector<float>& a, const std::vector<float>& b)
+    {
+        double difference = 0;
+        for (std::size_t i = 0; i < a.size(); ++i)
+            difference = std::max(difference, std::fabs(static_cast<double>(a[i]) - b[i]));
+        return difference;
+    }
+
+    /** Runs the kernel the given number of times and reports the fastest run, returns the means of the last run */
+    std::vector<float> run(const char* name, std::size_t repetitions, std::size_t bytes, const std::function<std::vector<float>()>& kernel, const std::vector<float>* reference)
+    {
+        std::vector<float> means;
+        double best = std::numeric_limits<double>::max();
+        for (std::size_t repetition = 0; repetition < repetitions; ++repetition)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            means = kernel();
+            const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+            best = std::min(best, elapsed.count());
+        }
+
+        const double gigabytesPerSecond = (bytes / 1e9) / (best / 1000.0);
+        if (reference)
+            std::printf("%-28s %10.1f ms %8.2f GB/s   max |diff| %.2e\n", name, best, gigabytesPerSecond, maxDifference(means, *reference));
+        else
+            std::printf("%-28s %10.1f ms %8.2f GB/s\n", name, best, gigabytesPerSecond);
+        return means;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const std::size_t rows = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 100000;
+    const std::size_t dimensions = (argc > 2) ? std::strtoull(argv[2], nullptr, 10) : 2000;
+    const std::size_t numClusters = (argc > 3) ? std::strtoull(argv[3], nullptr, 10) : 20;
+    const double density = (argc > 4) ? std::strtod(argv[4], nullptr) : 0.1;
+    const std::size_t repetitions = (argc > 5) ? std::strtoull(argv[5], nullptr, 10) : 3;
+    if (rows == 0 || dimensions == 0 || numClusters == 0 || repetitions == 0)
+    {
+        std::fprintf(stderr, "usage: %s [rows] [dimensions] [clusters] [density] [repetitions]\n", argv[0]);
+        return 1;
+    }
+
+    const std::vector<float> data = syntheticMatrix(rows, dimensions, density);
+    const std::vector<Cluster> clusters = syntheticClusters(rows, numClusters);
+    const PointView vec{ data.data(), dimensions };
+    const std::size_t bytes = data.size() * sizeof(float);
+
+    std::printf("%zu rows x %zu dimensions, %zu clusters, density %.3f, %d threads\n\n", rows, dimensions, numClusters, density, omp_get_max_threads());
+
+    const auto noProgress = [](std::size_t) { return true; };
+    const std::vector<float> reference = run("per-dimension loop", repetitions, bytes, [&]() { return perDimensionMeans(vec, clusters, dimensions); }, nullptr);
+
+    run("tiles (point view)", repetitions, bytes, [&]()
+        {
+            cde::ClusterStatistics statistics;
+            cde::accumulateClusterTiles(vec, clusters, statistics, dimensions, 0, noProgress);
+            return statistics.means();
+        }, &reference);
+
+    run("tiles (row kernel)", repetitions, bytes, [&]()
+        {
+            cde::ClusterStatistics statistics;
+            cde::accumulateContiguousClusterTiles(data.data(), clusters, statistics, dimensions, 0, noProgress);
+            return statistics.means();
+        }, &reference);
+
+    run("row chunks (row kernel)", repetitions, bytes, [&]()
+        {
+            constexpr std::size_t CHUNK_ROWS = 4096;
+            cde::ClusterStatistics statistics;
+            cde::accumulateRowChunks(clusters, statistics, dimensions, rows, CHUNK_ROWS, cde::contiguousRowAdder(data.data(), dimensions), noProgress);
+            return statistics.means();
+        }, &reference);
+
+    // the sparse copy is built once per dataset and not part of the aggregation time
+    const cde::SparseMatrix sparseMatrix = cde::SparseMatrix::fromDense(data.data(), rows, dimensions);
+    run("sparse rows (CSR)", repetitions, bytes, [&]()
+        {
+            cde::ClusterStatistics statistics;
+            cde::accumulateSparseClusterRows(sparseMatrix, clusters, statistics, noProgress);
+            return statistics.means();
+        }, &reference);
+
+    return 0;
+}
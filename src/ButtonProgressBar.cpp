@@ -18,6 +18,7 @@ ButtonProgressBar::ButtonProgressBar(QWidget *parent, QWidget* button, QWidget*
 	:QWidget(parent)
 	, _button(nullptr)
 	, _progressBar(nullptr)
+	, _cancelButton(nullptr)
 
 {
     QGridLayout* newLayout = new QGridLayout();
@@ -89,6 +90,18 @@ ButtonProgressBar::ButtonProgressBar(QWidget *parent, QWidget* button, QWidget*
             _progressBar->hide();
         }
     }
+    {
+        // only visible while the table is being computed
+        _cancelButton = new QPushButton("Cancel", this);
+        _cancelButton->setToolTip("Stop computing the differential expression");
+        _cancelButton->hide();
+        newLayout->addWidget(_cancelButton, 0, 1);
+        connect(_cancelButton, &QPushButton::clicked, this, [this]()
+            {
+                _cancelButton->setEnabled(false);
+                emit cancelRequested();
+            });
+    }
     showStatus(QTableItemModel::Status::Undefined);
 	delete layout();
     setLayout(newLayout);
@@ -117,6 +130,8 @@ void ButtonProgressBar::setProgressBarText(const QString& format)
 
 void ButtonProgressBar::showStatus(QTableItemModel::Status status)
 {
+	_cancelButton->setVisible(status == QTableItemModel::Status::Updating);
+	_cancelButton->setEnabled(true);
 	switch(status)
 	{
 		case QTableItemModel::Status::Undefined:
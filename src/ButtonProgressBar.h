@@ -20,9 +20,13 @@ public:
 
 public slots:
 	void showStatus(QTableItemModel::Status status);
+
+signals:
+	void cancelRequested();
 	
 private:
 	
 	QProgressBar		*_progressBar;
 	QPushButton			*_button;
+	QPushButton			*_cancelButton;
 };
\ No newline at end of file
@@ -9,6 +9,13 @@
 #include "WordWrapHeaderView.h"
 #include "ButtonProgressBar.h"
 #include "TableView.h"
+#include "ClusterStatistics.h"
+#include "SparseMatrix.h"
+#include "StatisticalTests.h"
+#include "RankSumTest.h"
+#include "StatisticsDiskCache.h"
+#include "OneVsRest.h"
+#include "PairwiseDE.h"
 
 // HDPS includes
 #include "PointData/PointData.h"
@@ -25,12 +32,20 @@
 #include <QFileDialog>
 #include <QSettings>
 #include <QDebug>
+#include <QtConcurrent>
+#include <QCryptographicHash>
+#include <QStandardPaths>
+#include <QDir>
+#include <QElapsedTimer>
 
 #include <iostream>
 #include <cassert>
 #include <set>
 #include <algorithm>
 #include <cmath>
+#include <numeric>
+#include <type_traits>
+#include <atomic>
 
 
 
@@ -116,135 +131,572 @@ namespace local
         return static_cast<float>(floor(n * pow(10., d) + 0.5) / pow(10., d));
     }
 
+    /** Table cell of a statistic rounded to three decimals, "N/A" when it is undefined */
+    QVariant roundedCell(double value)
+    {
+        if (std::isnan(value))
+            return QString("N/A");
+        return fround(value, 3);
+    }
+
+    /** Table cell of a p-value; p-values are not rounded, the small ones are the interesting ones */
+    QVariant pValueCell(double pValue)
+    {
+        if (std::isnan(pValue))
+            return QString("N/A");
+        return pValue;
+    }
+
 
     
-    bool clusterDatset_has_computed_DE_Statistics(mv::Dataset<Clusters> clusterDataset)
+    bool clusterDataset_has_parent_Point_Dataset(mv::Dataset<Clusters> clusterDataset)
+    {
+        return clusterDataset->getParent<Points>().isValid();
+    }
+
+
+    const QString DE_Statistics_VarianceDatasetName = "DE_Statistics_Variance";
+    const QString DE_Statistics_NonZeroFractionDatasetName = "DE_Statistics_NonZeroFraction";
+    const QString DE_Statistics_ClusterSizesDatasetName = "DE_Statistics_ClusterSizes";
+    const QString DE_PairwiseDatasetName = "DE_Pairwise";
+    const QString DE_PairwiseTopKDatasetName = "DE_PairwiseTopK";
+    const QString DE_PairwiseTopKDimensionsDatasetName = "DE_PairwiseTopKDimensions";
+
+    Dataset<Points> findChildDataset(mv::Dataset<Clusters> clusterDataset, const QString& name)
     {
-        if(clusterDataset.isValid())
+        const auto& childDatasets = clusterDataset->getChildren({ PointType });
+        for (qsizetype i = 0; i < childDatasets.size(); ++i)
         {
-            const QString child_DE_Statistics_DatasetName = "DE_Statistics";
-            const auto& childDatasets = clusterDataset->getChildren({ PointType });
-            for (qsizetype i = 0; i < childDatasets.size(); ++i)
-            {
-                if (childDatasets[i]->getGuiName() == child_DE_Statistics_DatasetName)
-                {
-                    return true;
+            if (childDatasets[i]->getGuiName() == name)
+                return childDatasets[i];
+        }
+        return Dataset<Points>();
+    }
 
-                }
-            }
+    /** Looks up the DE_Statistics of the cluster dataset and its siblings in a single pass over its children */
+    DE_StatisticsDatasets findStatisticsDatasets(mv::Dataset<Clusters> clusterDataset)
+    {
+        DE_StatisticsDatasets result;
+        const auto& childDatasets = clusterDataset->getChildren({ PointType });
+        for (qsizetype i = 0; i < childDatasets.size(); ++i)
+        {
+            const QString name = childDatasets[i]->getGuiName();
+            if (name == "DE_Statistics")
+                result.means = childDatasets[i];
+            else if (name == DE_Statistics_VarianceDatasetName)
+                result.variances = childDatasets[i];
+            else if (name == DE_Statistics_NonZeroFractionDatasetName)
+                result.nonZeroFractions = childDatasets[i];
+            else if (name == DE_Statistics_ClusterSizesDatasetName)
+                result.clusterSizes = childDatasets[i];
         }
-        return false;
+        if (result.means.isValid())
+            result.meansData = result.means.get();
+        return result;
     }
 
-    bool clusterDataset_has_parent_Point_Dataset(mv::Dataset<Clusters> clusterDataset)
+    void createStatisticsDataset(mv::Dataset<Clusters> clusterDataset, const QString& name, std::vector<float>&& values, std::size_t numDimensions, const std::vector<QString>& dimensionNames)
     {
-        return clusterDataset->getParent<Points>().isValid();
+        mv::Dataset<Points> newDataset = mv::data().createDataset("Points", name, clusterDataset);
+        events().notifyDatasetAdded(newDataset);
+        newDataset->setDataElementType<float>();
+        newDataset->setData(std::move(values), numDimensions);
+        newDataset->setDimensionNames(dimensionNames);
+        events().notifyDatasetDataChanged(newDataset);
     }
 
+    /** Replaces the values of the named child dataset of the cluster dataset, creating it when there is none */
+    void setChildDataset(mv::Dataset<Clusters> clusterDataset, const QString& name, std::vector<float>&& values, std::size_t numDimensions, const std::vector<QString>& dimensionNames)
+    {
+        mv::Dataset<Points> dataset = findChildDataset(clusterDataset, name);
+        if (!dataset.isValid())
+        {
+            createStatisticsDataset(clusterDataset, name, std::move(values), numDimensions, dimensionNames);
+            return;
+        }
+        dataset->setData(std::move(values), numDimensions);
+        dataset->setDimensionNames(dimensionNames);
+        events().notifyDatasetDataChanged(dataset);
+    }
 
-    std::ptrdiff_t get_DE_Statistics_Index(mv::Dataset<Clusters> clusterDataset)
+    /** Stores the per-cluster variances, non-zero fractions and cluster sizes next to the DE_Statistics means, skipping the ones that already exist */
+    void createSiblingStatisticsDatasets(mv::Dataset<Clusters> clusterDataset, const std::vector<QString>& dimensionNames, const cde::ClusterStatistics& statistics)
     {
-        const auto& clusters = clusterDataset->getClusters();
-        const auto numClusters = clusters.size();
+        if (!findChildDataset(clusterDataset, DE_Statistics_VarianceDatasetName).isValid())
+            createStatisticsDataset(clusterDataset, DE_Statistics_VarianceDatasetName, statistics.variances(), statistics.numDimensions, dimensionNames);
 
-        mv::Dataset<Points> points = clusterDataset->getParent<Points>();
-        const std::ptrdiff_t numDimensions = points->getNumDimensions();
+        if (!findChildDataset(clusterDataset, DE_Statistics_NonZeroFractionDatasetName).isValid())
+            createStatisticsDataset(clusterDataset, DE_Statistics_NonZeroFractionDatasetName, statistics.nonZeroFractions(), statistics.numDimensions, dimensionNames);
 
-        // check if the basic DE_Statistics for the cluster dataset has already been computed
-        std::ptrdiff_t child_DE_Statistics_DatasetIndex = -1;
-        const QString child_DE_Statistics_DatasetName = "DE_Statistics";
+        if (!findChildDataset(clusterDataset, DE_Statistics_ClusterSizesDatasetName).isValid())
         {
-            const auto& childDatasets = clusterDataset->getChildren({ PointType });
-            for (qsizetype i = 0; i < childDatasets.size(); ++i)
-            {
-                if (childDatasets[i]->getGuiName() == child_DE_Statistics_DatasetName)
+            std::vector<float> clusterSizes(statistics.clusterSizes.cbegin(), statistics.clusterSizes.cend());
+            createStatisticsDataset(clusterDataset, DE_Statistics_ClusterSizesDatasetName, std::move(clusterSizes), 1, { QString("Size") });
+        }
+    }
+
+    /**
+     * Returns a pointer to the values of a float points dataset, or copies them into storage for any other element type.
+     * With copy they are always copied, for a worker thread that reads them while the dataset may change.
+     */
+    const float* getFloatValues(const mv::Dataset<Points>& points, std::vector<float>& storage, bool copy = false)
+    {
+        const std::size_t numValues = static_cast<std::size_t>(points->getNumPoints()) * points->getNumDimensions();
+        const float* result = nullptr;
+        if (points->isFull() && !points->isProxy())
+        {
+            points->constVisitFromBeginToEnd([&result](auto begin, auto end)
                 {
-                    child_DE_Statistics_DatasetIndex = i;
-                    break;
-                }
-            }
+                    if constexpr (std::is_same_v<std::remove_cv_t<std::remove_reference_t<decltype(*begin)>>, float>)
+                    {
+                        if (begin != end)
+                            result = &*begin;
+                    }
+                });
+        }
+        if (result && copy)
+        {
+            storage.assign(result, result + numValues);
+            result = storage.data();
+        }
+        if (result == nullptr)
+        {
+            storage.resize(numValues);
+            for (std::size_t i = 0; i < numValues; ++i)
+                storage[i] = points->getValueAt(i);
+            result = storage.data();
+        }
+        return result;
+    }
+
+    /**
+     * Aggregates the per-cluster statistics of the parent points.
+     * Full, non-proxy point data is one contiguous row-major array, so it goes through the SIMD row kernels;
+     * everything else goes through the generic point view of visitData.
+     */
+    template<typename ClusterVector, typename ProgressFunction>
+    void accumulateClusterStatistics(Points& points, const ClusterVector& clusters, cde::ClusterStatistics& statistics, std::size_t tileSize, ProgressFunction progress)
+    {
+        const std::size_t numDimensions = points.getNumDimensions();
+        if (points.isFull() && !points.isProxy())
+        {
+            points.constVisitFromBeginToEnd([&clusters, &statistics, numDimensions, tileSize, &progress](auto begin, auto end)
+                {
+                    if (begin != end)
+                        cde::accumulateContiguousClusterTiles(&*begin, clusters, statistics, numDimensions, tileSize, progress);
+                    else
+                        statistics.reset(clusters.size(), numDimensions);
+                });
+        }
+        else
+        {
+            points.visitData([&clusters, &statistics, numDimensions, tileSize, &progress](auto vec)
+                {
+                    cde::accumulateClusterTiles(vec, clusters, statistics, numDimensions, tileSize, progress);
+                });
+        }
+    }
+
+    /**
+     * Same as accumulateClusterStatistics, reading the points once front to back in chunks of chunkRows rows, see cde::accumulateRowChunks.
+     * progress(chunk, bytesRead) is called after every chunk with the number of bytes of point data read so far.
+     */
+    template<typename ClusterVector, typename ProgressFunction>
+    void streamClusterStatistics(Points& points, const ClusterVector& clusters, cde::ClusterStatistics& statistics, std::size_t chunkRows, ProgressFunction progress)
+    {
+        const std::size_t numRows = points.getNumPoints();
+        const std::size_t numDimensions = points.getNumDimensions();
+        const auto chunkProgress = [&progress, numRows, numDimensions, chunkRows](std::size_t elementSize)
+        {
+            return [&progress, numRows, numDimensions, chunkRows, elementSize](std::size_t chunk)
+                {
+                    return progress(chunk, std::min(numRows, (chunk + 1) * chunkRows) * numDimensions * elementSize);
+                };
+        };
+
+        if (points.isFull() && !points.isProxy())
+        {
+            points.constVisitFromBeginToEnd([&clusters, &statistics, numRows, numDimensions, chunkRows, &chunkProgress](auto begin, auto end)
+                {
+                    if (begin != end)
+                        cde::accumulateRowChunks(clusters, statistics, numDimensions, numRows, chunkRows, cde::contiguousRowAdder(&*begin, numDimensions), chunkProgress(sizeof(*begin)));
+                    else
+                        statistics.reset(clusters.size(), numDimensions);
+                });
+        }
+        else
+        {
+            points.visitData([&clusters, &statistics, numRows, numDimensions, chunkRows, &chunkProgress](auto vec)
+                {
+                    cde::accumulateRowChunks(clusters, statistics, numDimensions, numRows, chunkRows, cde::pointViewRowAdder(vec), chunkProgress(sizeof(std::decay_t<decltype(vec[0][0])>)));
+                });
+        }
+    }
+
+    /** Gathers a column block of the points for the rank-sum test, directly from the storage when it is contiguous */
+    void gatherColumnBlock(Points& points, const std::vector<std::uint32_t>& rows, const std::vector<std::ptrdiff_t>& dimensions, std::vector<float>& columns)
+    {
+        const std::size_t numDimensions = points.getNumDimensions();
+        if (points.isFull() && !points.isProxy())
+        {
+            points.constVisitFromBeginToEnd([&rows, &dimensions, &columns, numDimensions](auto begin, auto end)
+                {
+                    if (begin != end)
+                        cde::gatherContiguousColumnBlock(&*begin, numDimensions, rows, dimensions, columns);
+                });
+        }
+        else
+        {
+            points.visitData([&rows, &dimensions, &columns](auto vec)
+                {
+                    cde::gatherColumnBlock(vec, rows, dimensions, columns);
+                });
         }
+    }
 
-        // if they are not available compute them now
-        if (child_DE_Statistics_DatasetIndex < 0)
+    /** Returns the closest ancestor points of the cluster dataset, i.e. the points its cluster indices refer to */
+    mv::Dataset<Points> findParentPoints(mv::Dataset<Clusters> clusterDataset)
+    {
+        mv::Dataset<Points> points;
+        DataHierarchyItems parents = clusterDataset->getDataHierarchyItem().getAncestors();
+        for (auto parent : parents)
         {
+            points = parent->getDataset<Points>();
+            if (points.isValid())
+                break;
+        }
+        return points;
+    }
 
+    /** Builds a CSR copy of contiguous point data with a fraction of non-zero values below threshold, returns nullptr otherwise */
+    std::shared_ptr<const cde::SparseMatrix> createSparseMatrix(Points& points, double threshold)
+    {
+        // only contiguous point data can be converted, and only pays off when it is sparse enough
+        if (!points.isFull() || points.isProxy())
+            return nullptr;
 
-            //compute the DE statistics for this cluster
+        const std::size_t numPoints = points.getNumPoints();
+        const std::size_t numDimensions = points.getNumDimensions();
 
-            const auto numPoints = points->getNumPoints();
+        std::shared_ptr<const cde::SparseMatrix> sparseMatrix;
+        points.constVisitFromBeginToEnd([&sparseMatrix, threshold, numPoints, numDimensions](auto begin, auto end)
+            {
+                if (begin == end)
+                    return;
+                const auto* data = &*begin;
+                if (cde::estimateDensity(data, numPoints, numDimensions) < threshold)
+                    sparseMatrix = std::make_shared<const cde::SparseMatrix>(cde::SparseMatrix::fromDense(data, numPoints, numDimensions));
+            });
+        return sparseMatrix;
+    }
 
-            std::vector<float> meanExpressions(numClusters * numDimensions, 0);
+    /** A computation without a cancel token always runs to its end */
+    bool isCancelled(const std::atomic<bool>* cancelled)
+    {
+        return cancelled && cancelled->load(std::memory_order_relaxed);
+    }
 
-            int x = omp_get_max_threads();
-            int y = omp_get_num_threads();
+    /**
+     * Aggregates the per-cluster statistics of the points, from a sparse copy when their density is below sparseDensityThreshold.
+     * The sparse copy only lives for the aggregation. A non-zero streamingChunkRows streams the dense points in row chunks and reports the read rate in the progress label.
+     * Only reads the point data, so it can run on a worker thread.
+     * Returns false when the computation was cancelled through its cancel token, the statistics are incomplete then.
+     */
+    template<typename ClusterVector>
+    bool computeClusterStatistics(Points& points, const ClusterVector& clusters, double sparseDensityThreshold, std::size_t requestedTileSize, std::size_t streamingChunkRows, const std::string& message, ProgressManager& progressManager, const std::atomic<bool>* cancelled, cde::ClusterStatistics& statistics)
+    {
+        const auto progress = [&progressManager, cancelled](std::size_t index)
+        {
+            progressManager.print(index);
+            return !isCancelled(cancelled);
+        };
 
-           
-            points->visitData([&clusters, &meanExpressions, numClusters, numDimensions](auto vec)
+        const std::shared_ptr<const cde::SparseMatrix> sparseMatrix = createSparseMatrix(points, sparseDensityThreshold);
+        if (sparseMatrix)
+        {
+            progressManager.start(clusters.size(), message);
+            cde::accumulateSparseClusterRows(*sparseMatrix, clusters, statistics, progress);
+        }
+        else if (streamingChunkRows > 0)
+        {
+            constexpr qint64 RATE_UPDATE_INTERVAL = 250;    // ms
+            const QString label = QString::fromStdString(message);
+            QElapsedTimer timer;
+            timer.start();
+            qint64 lastUpdate = 0;
+            const auto chunkProgress = [&progressManager, cancelled, &label, &timer, &lastUpdate](std::size_t chunk, std::size_t bytesRead)
+            {
+                progressManager.print(chunk);
+                const qint64 elapsed = timer.elapsed();
+                if (elapsed - lastUpdate >= RATE_UPDATE_INTERVAL)
                 {
+                    lastUpdate = elapsed;
+                    const double megabytesPerSecond = (bytesRead / double(1 << 20)) / (elapsed / 1000.0);
+                    progressManager.setLabelText(QString("%1 (%2 MB/s)").arg(label).arg(megabytesPerSecond, 0, 'f', 0));
+                }
+                return !isCancelled(cancelled);
+            };
 
-					#pragma omp parallel for schedule(dynamic, 1)
-                    for (int dimension = 0; dimension < numDimensions; ++dimension)
-                    {
-                        //#pragma omp parallel for schedule(dynamic, 1)
-                        for (std::ptrdiff_t clusterIdx = 0; clusterIdx < numClusters; ++clusterIdx)
-                        {
-                            const auto& cluster = clusters[clusterIdx];
-                            const auto& clusterIndices = cluster.getIndices();
-                            std::size_t offset = (clusterIdx * numDimensions) + dimension;
-                            for (auto row : clusterIndices)
-                            {
-                                meanExpressions[offset] += vec[row][dimension];
-                            }
-                            meanExpressions[offset] /= clusterIndices.size();
-                        }
-                       
-                    }
-                });
+            progressManager.start(cde::rowChunkCount(points.getNumPoints(), streamingChunkRows), message);
+            streamClusterStatistics(points, clusters, statistics, streamingChunkRows, chunkProgress);
+        }
+        else
+        {
+            const std::size_t tileSize = cde::resolveTileSize(clusters.size(), points.getNumDimensions(), requestedTileSize);
+            progressManager.start(cde::tileCount(points.getNumDimensions(), tileSize), message);
+            accumulateClusterStatistics(points, clusters, statistics, tileSize, progress);
+        }
+        progressManager.end();
+        return !isCancelled(cancelled);
+    }
 
-            
+    /**
+     * Key of the per-cluster statistics in the disk cache: a hash of the point values, the dimension names and the cluster indices.
+     * Returns an empty key when the points are not stored as one contiguous block, these are not cached.
+     */
+    template<typename ClusterVector>
+    QByteArray statisticsCacheKey(Points& points, const ClusterVector& clusters, const std::vector<QString>& dimensionNames)
+    {
+        if (!points.isFull() || points.isProxy())
+            return {};
+
+        QCryptographicHash hash(QCryptographicHash::Sha1);
+        const auto addValue = [&hash](auto value) { hash.addData(QByteArrayView(reinterpret_cast<const char*>(&value), sizeof(value))); };
+
+        bool contiguous = false;
+        points.constVisitFromBeginToEnd([&addValue, &contiguous](auto begin, auto end)
+            {
+                using Value = std::decay_t<decltype(*begin)>;
+                if (begin == end)
+                    return;
+                contiguous = true;
+                addValue(static_cast<std::uint32_t>(sizeof(Value)));
+                addValue(static_cast<std::uint8_t>(std::is_floating_point_v<Value>));
+                addValue(static_cast<std::uint8_t>(std::is_signed_v<Value>));
+                addValue(cde::contentHash(&*begin, static_cast<std::size_t>(end - begin) * sizeof(Value)));
+            });
+        if (!contiguous)
+            return {};
+
+        addValue(static_cast<std::uint64_t>(points.getNumPoints()));
+        addValue(static_cast<std::uint64_t>(points.getNumDimensions()));
+        for (const QString& name : dimensionNames)
+            hash.addData(name.toUtf8().append('\0'));
 
+        addValue(static_cast<std::uint64_t>(clusters.size()));
+        for (const auto& cluster : clusters)
+        {
+            const auto& indices = cluster.getIndices();
+            addValue(static_cast<std::uint64_t>(indices.size()));
+            hash.addData(QByteArrayView(reinterpret_cast<const char*>(indices.data()), static_cast<qsizetype>(indices.size() * sizeof(indices[0]))));
+        }
+        return hash.result();
+    }
 
+    /** Signature of everything a DE table depends on besides the DE_Statistics themselves, which version the table separately */
+    QByteArray resultKey(const QStringList& datasetIds, const std::vector<char>& selected, const std::vector<std::vector<unsigned>>& selectedClusters,
+        bool welchTest, bool rankSumTest, std::size_t topK, std::uint64_t preInfoVersion, std::uint64_t postInfoVersion)
+    {
+        QCryptographicHash hash(QCryptographicHash::Sha1);
+        const auto addValue = [&hash](auto value) { hash.addData(QByteArrayView(reinterpret_cast<const char*>(&value), sizeof(value))); };
 
+        for (qsizetype i = 0; i < datasetIds.size(); ++i)
+        {
+            hash.addData(datasetIds[i].toUtf8());
+            addValue(static_cast<std::uint8_t>(selected[i]));
+            addValue(static_cast<std::uint64_t>(selectedClusters[i].size()));
+            for (unsigned cluster : selectedClusters[i])
+                addValue(cluster);
+        }
+        addValue(static_cast<std::uint8_t>(welchTest));
+        addValue(static_cast<std::uint8_t>(rankSumTest));
+        addValue(static_cast<std::uint64_t>(topK));
+        addValue(preInfoVersion);
+        addValue(postInfoVersion);
+        return hash.result();
+    }
+
+    /**
+     * Reads the per-cluster statistics from the disk cache, or computes them and adds them to the cache.
+     * Returns false when the computation was cancelled through its cancel token, the statistics are incomplete then.
+     */
+    template<typename ClusterVector>
+    bool computeCachedClusterStatistics(Points& points, const ClusterVector& clusters, const std::vector<QString>& dimensionNames, double sparseDensityThreshold, std::size_t requestedTileSize, std::size_t streamingChunkRows, const std::string& message, ProgressManager& progressManager, const std::atomic<bool>* cancelled, cde::StatisticsDiskCache& diskCache, cde::ClusterStatistics& statistics)
+    {
+        QByteArray key;
+        if (diskCache.isEnabled())
+        {
+            key = statisticsCacheKey(points, clusters, dimensionNames);
+            if (!key.isEmpty() && diskCache.load(key, clusters.size(), points.getNumDimensions(), statistics))
+                return true;
+        }
 
+        if (!computeClusterStatistics(points, clusters, sparseDensityThreshold, requestedTileSize, streamingChunkRows, message, progressManager, cancelled, statistics))
+            return false;
 
-            auto *core = Application::core();
-            mv::Dataset<Points> newDataset = mv::data().createDataset("Points", child_DE_Statistics_DatasetName, clusterDataset);
-            events().notifyDatasetAdded(newDataset);
-            newDataset->setDataElementType<float>();
-            newDataset->setData(std::move(meanExpressions), numDimensions);
-            newDataset->setDimensionNames(points->getDimensionNames());
+        if (!key.isEmpty())
+            diskCache.store(key, statistics);
+        return true;
+    }
 
-            events().notifyDatasetDataChanged(newDataset);
+    /** Stores per-cluster statistics as DE_Statistics (the means) and its siblings, skipping the datasets that already exist */
+    void storeClusterStatistics(mv::Dataset<Clusters> clusterDataset, const std::vector<QString>& dimensionNames, const cde::ClusterStatistics& statistics)
+    {
+        const QString child_DE_Statistics_DatasetName = "DE_Statistics";
+        if (!findChildDataset(clusterDataset, child_DE_Statistics_DatasetName).isValid())
+            createStatisticsDataset(clusterDataset, child_DE_Statistics_DatasetName, statistics.means(), statistics.numDimensions, dimensionNames);
 
+        createSiblingStatisticsDatasets(clusterDataset, dimensionNames, statistics);
+    }
 
-            // now fild the child indices for this dataset
-            child_DE_Statistics_DatasetIndex = -1;
-            {
-                const auto& childDatasets = clusterDataset->getChildren({ PointType });
-                for (qsizetype i = 0; i < childDatasets.size(); ++i)
+    /** Applies a membership delta to the per-cluster statistics, reading only the moved rows of the points */
+    void applyClusterMembershipDelta(Points& points, const cde::MembershipDelta& delta, std::size_t numClusters, cde::ClusterStatistics& statistics)
+    {
+        const std::size_t numDimensions = points.getNumDimensions();
+        if (points.isFull() && !points.isProxy())
+        {
+            points.constVisitFromBeginToEnd([&delta, numClusters, &statistics, numDimensions](auto begin, auto end)
                 {
-                    if (childDatasets[i]->getGuiName() == child_DE_Statistics_DatasetName)
-                    {
-                        child_DE_Statistics_DatasetIndex = i;
-                        break;
-                    }
-                }
-            }
+                    if (begin != end)
+                        cde::applyMembershipDelta(statistics, delta, numClusters, cde::contiguousRowAdder(&*begin, numDimensions));
+                });
+        }
+        else
+        {
+            points.visitData([&delta, numClusters, &statistics](auto vec)
+                {
+                    cde::applyMembershipDelta(statistics, delta, numClusters, cde::pointViewRowAdder(vec));
+                });
+        }
+    }
+
+    /** Replaces the values of the DE_Statistics and its siblings in place */
+    void updateStatisticsDatasets(const DE_StatisticsDatasets& datasets, const cde::ClusterStatistics& statistics)
+    {
+        const auto update = [](mv::Dataset<Points> dataset, std::vector<float>&& values, std::size_t numDimensions)
+        {
+            if (!dataset.isValid())
+                return;
+            dataset->setData(std::move(values), numDimensions);
+            events().notifyDatasetDataChanged(dataset);
+        };
+        update(datasets.means, statistics.means(), statistics.numDimensions);
+        update(datasets.variances, statistics.variances(), statistics.numDimensions);
+        update(datasets.nonZeroFractions, statistics.nonZeroFractions(), statistics.numDimensions);
+        update(datasets.clusterSizes, std::vector<float>(statistics.clusterSizes.cbegin(), statistics.clusterSizes.cend()), 1);
+    }
+
+    /** Per-cluster tables together with the storage they point into when they had to be copied */
+    struct StoredClusterTables
+    {
+        cde::ClusterTables      tables;
+        std::vector<float>      means;
+        std::vector<float>      variances;
+        std::vector<float>      nonZeroFractions;
+        std::vector<float>      clusterSizes;
+    };
+
+    /**
+     * Reads the per-cluster tables of the clusters from their DE_Statistics and its siblings, returns false when there are no DE_Statistics.
+     * With copy the tables never point into the datasets, see getFloatValues.
+     */
+    bool readClusterTables(const DE_StatisticsDatasets& datasets, const QVector<Cluster>& clusters, StoredClusterTables& stored, bool copy = false)
+    {
+        if (!datasets.means.isValid())
+            return false;
 
+        cde::ClusterTables& tables = stored.tables;
+        tables.numClusters = clusters.size();
+        tables.numDimensions = datasets.meansData->getNumDimensions();
+        tables.means = getFloatValues(datasets.means, stored.means, copy);
+
+        if (datasets.variances.isValid())
+            tables.variances = getFloatValues(datasets.variances, stored.variances, copy);
+
+        if (datasets.nonZeroFractions.isValid())
+            tables.nonZeroFractions = getFloatValues(datasets.nonZeroFractions, stored.nonZeroFractions, copy);
+
+        // the stored cluster sizes are the ones the statistics were computed with
+        tables.clusterSizes.clear();
+        if (datasets.clusterSizes.isValid() && (datasets.clusterSizes->getNumPoints() == tables.numClusters))
+        {
+            const float* sizes = getFloatValues(datasets.clusterSizes, stored.clusterSizes);
+            tables.clusterSizes.assign(sizes, sizes + tables.numClusters);
         }
+        else
+        {
+            for (const auto& cluster : clusters)
+                tables.clusterSizes.push_back(cluster.getIndices().size());
+        }
+        return true;
+    }
+
+    /** Points the tables at freshly computed statistics */
+    void setClusterTables(const cde::ClusterStatistics& statistics, StoredClusterTables& stored)
+    {
+        stored.means = statistics.means();
+        stored.variances = statistics.variances();
+        stored.nonZeroFractions = statistics.nonZeroFractions();
 
-        return child_DE_Statistics_DatasetIndex;
+        cde::ClusterTables& tables = stored.tables;
+        tables.numClusters = statistics.numClusters;
+        tables.numDimensions = statistics.numDimensions;
+        tables.means = stored.means.data();
+        tables.variances = stored.variances.data();
+        tables.nonZeroFractions = stored.nonZeroFractions.data();
+        tables.clusterSizes = statistics.clusterSizes;
     }
 
-    Dataset<Points> get_DE_Statistics_Dataset(mv::Dataset<Clusters> clusterDataset)
+    /** Inputs, collected on the GUI thread, and rows, built on a worker thread, of the marker table */
+    struct MarkerTable
+    {
+        enum Column { ID, CLUSTER, RANK, MEAN_DE, T_STATISTIC, P_VALUE, CLUSTER_MEAN, REST_MEAN, CLUSTER_NON_ZERO_FRACTION, REST_NON_ZERO_FRACTION, COLUMN_COUNT };
+
+        StoredClusterTables                 stored;             /** copies, the datasets may change while the worker reads them */
+        std::vector<QString>                dimensionNames;
+        std::vector<QString>                clusterNames;
+        std::vector<qsizetype>              matchedDimensions;  /** matched dimension of every dimension of the dataset, -1 when unmatched */
+        std::size_t                         markersPerCluster = 0;
+        std::vector<std::vector<QVariant>>  rows;
+        std::vector<qsizetype>              rowDimensions;
+    };
+
+    /** Inputs, collected on the GUI thread, and tensors, computed on a worker thread, of the pairwise differences */
+    struct PairwiseTensors
     {
-        auto clusterDataset_DE_Statitstics_Index = get_DE_Statistics_Index(clusterDataset);
-        assert(clusterDataset_DE_Statitstics_Index >= 0);
-        const auto& clusterDataset_Children = clusterDataset->getChildren({ PointType });
-        Dataset<Points> DE_Statistics = clusterDataset_Children[clusterDataset_DE_Statitstics_Index];
+        StoredClusterTables                 stored;             /** copies, the datasets may change while the worker reads them */
+        std::size_t                         k = 0;              /** 0 for the full tensor, the number of largest differences otherwise */
+        std::vector<float>                  values;
+        std::vector<float>                  dimensions;         /** only for the top k */
+        std::size_t                         numDimensions = 0;
+    };
+
+    /** Compares every cluster with all its other clusters and builds a row per marker */
+    void buildMarkerRows(MarkerTable& table)
+    {
+        const std::vector<cde::OneVsRestMarker> markers = cde::oneVsRestMarkers(table.stored.tables, table.markersPerCluster);
 
-        return DE_Statistics;
+        const std::ptrdiff_t numMarkers = static_cast<std::ptrdiff_t>(markers.size());
+        table.rows.resize(numMarkers);
+        table.rowDimensions.resize(numMarkers);
+        #pragma omp parallel for schedule(static)
+        for (std::ptrdiff_t i = 0; i < numMarkers; ++i)
+        {
+            const cde::OneVsRestMarker& marker = markers[i];
+            std::vector<QVariant>& row = table.rows[i];
+            row.resize(MarkerTable::COLUMN_COUNT);
+            row[MarkerTable::ID] = table.dimensionNames[marker.dimension];
+            row[MarkerTable::CLUSTER] = table.clusterNames[marker.cluster];
+            row[MarkerTable::RANK] = marker.rank + 1;
+            row[MarkerTable::MEAN_DE] = fround(marker.clusterMean - marker.restMean, 3);
+            row[MarkerTable::T_STATISTIC] = roundedCell(marker.t);
+            row[MarkerTable::P_VALUE] = pValueCell(marker.pValue);
+            row[MarkerTable::CLUSTER_MEAN] = fround(marker.clusterMean, 3);
+            row[MarkerTable::REST_MEAN] = fround(marker.restMean, 3);
+            row[MarkerTable::CLUSTER_NON_ZERO_FRACTION] = roundedCell(marker.clusterNonZeroFraction);
+            row[MarkerTable::REST_NON_ZERO_FRACTION] = roundedCell(marker.restNonZeroFraction);
+            table.rowDimensions[i] = table.matchedDimensions[marker.dimension];
+        }
     }
 
     QSet<unsigned> getClusterIndices(const QStringList &clusters, const QStringList &selection)
@@ -305,20 +757,117 @@ namespace local
     }
 
 }
+
+/** Snapshot of everything computeDE needs, taken on the GUI thread so the computation itself can run on a worker thread */
+struct ClusterDifferentialExpressionPlugin::DEJob
+{
+    struct Input
+    {
+        bool                                        selected = false;
+        mv::Dataset<Clusters>                       clusterDataset;     /** only used on the GUI thread */
+        Points*                                     points = nullptr;   /** parent points, only read by the worker */
+        QString                                     pointsId;
+        QString                                     name;
+        QVector<Cluster>                            clusters;
+        std::vector<unsigned>                       selectedClusters;   /** sorted */
+        bool                                        hasStatistics = false;
+        local::StoredClusterTables                  statistics;         /** valid when hasStatistics, copies owned by the job */
+        std::shared_ptr<const DE_StatisticsDatasets> statisticsDatasets; /** the DE_Statistics read into statistics, version of groupStatistics */
+        std::shared_ptr<const cde::GroupStatistics> groupStatistics;    /** pooled statistics of the selected clusters found in the cache, nullptr when the worker pools them */
+    };
+
+    std::vector<Input>                                  inputs;             /** one per loaded dataset */
+    std::atomic<bool>                                   cancelled{ false }; /** set on the GUI thread to stop the worker of this job, see cancelComputeDE */
+    bool                                                inputsChanged = false;  /** the points the worker read changed or went away, its statistics are discarded */
+    QByteArray                                          resultKey;          /** signature of the selection, see local::resultKey */
+    std::vector<std::vector<QString>>                   dimensionNames;     /** per loaded dataset */
+    qsizetype                                           numSelectedDatasets = 0;
+    qsizetype                                           testDatasets[2] = { -1, -1 };
+    bool                                                welchTest = false;
+    bool                                                rankSumTest = false;
+    QVariantMap                                         preInfoMap;
+    QVariantMap                                         postInfoMap;
+    std::shared_ptr<const cde::DimensionMatching>       dimensionMatching;  /** nullptr when the dimension names still have to be matched */
+    std::size_t                                         tileSize = 0;
+    std::size_t                                         streamingChunkRows = 0;    /** 0 aggregates in dimension tiles */
+    std::size_t                                         topK = 0;                  /** number of table rows, 0 for a row per dimension */
+    std::size_t                                         rankBlockSize = 0;
+    double                                              sparseDensityThreshold = 0;
+};
+
+/** Computation of the statistics of a new or changed cluster dataset on a worker thread, applied on the GUI thread once done */
+struct ClusterDifferentialExpressionPlugin::StatisticsUpdateJob
+{
+    mv::Dataset<Clusters>                               clusterDataset;     /** only used on the GUI thread */
+    Points*                                             points = nullptr;   /** parent points, only read by the worker */
+    QString                                             pointsId;
+    QVector<Cluster>                                    clusters;
+    std::vector<cde::ClusterMember>                     members;            /** the cluster members the statistics are computed for */
+    std::vector<QString>                                dimensionNames;
+    std::string                                         message;
+    std::atomic<bool>                                   cancelled{ false }; /** set on the GUI thread to stop the worker, see cancelStatisticsUpdate */
+    bool                                                store = false;      /** computes missing DE_Statistics, stored as new datasets, instead of updating tracked ones */
+    bool                                                restart = false;    /** cancelled as its points changed, a store job is requested again */
+    std::size_t                                         tileSize = 0;
+    std::size_t                                         streamingChunkRows = 0;
+    double                                              sparseDensityThreshold = 0;
+    cde::ClusterStatistics                              statistics;         /** output of the worker */
+};
+
+/** A one-off computation on the per-cluster tables, such as the marker table, run on a worker thread and published on the GUI thread */
+struct ClusterDifferentialExpressionPlugin::BatchJob
+{
+    QString                                             name;               /** progress label */
+    std::atomic<bool>                                   cancelled{ false }; /** set on the GUI thread, a cancelled job is not published, see cancelBatchJob */
+    bool                                                replacesTable = false;  /** publishes a table, which a later computeDE replaces */
+    std::function<void(const std::atomic<bool>&)>       compute;            /** runs on the worker thread, only reads what the job owns */
+    std::function<void()>                               publish;            /** runs on the GUI thread once compute is done */
+};
+
+/** Output of the worker, committed to the datasets and the table model on the GUI thread */
+struct ClusterDifferentialExpressionPlugin::DEResult
+{
+    bool                                                    cancelled = false;
+    std::vector<cde::ClusterStatistics>                     statistics;         /** per loaded dataset */
+    std::vector<char>                                       computedStatistics; /** the datasets whose statistics were computed by the worker */
+    std::vector<std::shared_ptr<const cde::GroupStatistics>> groupStatistics;   /** pooled statistics of the selected clusters, per loaded dataset */
+    std::shared_ptr<const cde::DimensionMatching>           dimensionMatching;
+    bool                                                    matchedDimensions = false;  /** the dimension names were matched by the worker */
+    std::size_t                                             totalColumnCount = 0;
+    std::vector<std::vector<QVariant>>                      rows;
+    std::vector<qsizetype>                                  rowDimensions;      /** matched dimension of every row in top K mode, empty when every dimension has a row */
+    std::vector<QTableItemModel::Column>                    columns;            /** cells of a table taken from the result history, used instead of rows */
+};
+
 ClusterDifferentialExpressionPlugin::ClusterDifferentialExpressionPlugin(const mv::plugin::PluginFactory* factory)
     : ViewPlugin(factory)
     , _originalName(getGuiName())
     , _dropWidget(nullptr)
-    , _identicalDimensions(false)
     , _preInfoVariantAction(this, "TableViewLeftSideInfo")
     , _postInfoVariantAction(this, "TableViewRightSideInfo")
     , _primaryToolbarAction(this, "Primary Toolbar")
     , _loadedDatasetsAction(this)
     , _filterOnIdAction(this, "Filter on Id")
     , _autoUpdateAction(this, "auto update", false)
+    , _autoUpdateDelayAction(this, "Auto Update Delay", 0, 5000, 300)
     , _selectedIdAction(this, "Last selected Id")
     , _selectedDimensionAction(this, "Selected Dimension")
     , _updateStatisticsAction(this, "Calculate Differential Expression")
+    , _statisticsTileSizeAction(this, "Statistics Tile Size", 0, 65536, 0)
+    , _sparseDensityThresholdAction(this, "Sparse Density Threshold", 0.0f, 1.0f, 0.1f, 3)
+    , _welchTestAction(this, "Welch T-Test", false)
+    , _rankSumTestAction(this, "Wilcoxon Rank-Sum", false)
+    , _rankTestBlockSizeAction(this, "Rank Test Block Size", 0, 65536, 0)
+    , _statisticsDiskCacheSizeAction(this, "Statistics Disk Cache Size", 0, 65536, 2048)
+    , _streamingChunkRowsAction(this, "Streaming Chunk Rows", 0, 1 << 24, 0)
+    , _computeMarkersAction(this, "Compute Cluster Markers")
+    , _markersPerClusterAction(this, "Markers per Cluster", 1, 1000, 10)
+    , _computePairwiseDEAction(this, "Compute Pairwise DE")
+    , _pairwiseTopKAction(this, "Pairwise DE Top K", 0, 1000, 50)
+    , _topKRowsAction(this, "Top K", 1, 1000000, 200)
+    , _showAllRowsAction(this, "Show All", true)
+    , _resultHistorySizeAction(this, "Result History Size", 0, 16384, 512)
+    , _resultHistoryUsageAction(this, "Result History")
     , _sortFilterProxyModel(new cde::SortFilterProxyModel)
     , _tableItemModel(new QTableItemModel(nullptr, false))
     , _infoTextAction(this, "IntoText")
@@ -328,6 +877,10 @@ ClusterDifferentialExpressionPlugin::ClusterDifferentialExpressionPlugin(const m
 	, _pairwiseDiffExpResultsAction(this, "PairwiseDifferentialExpressionResults")
 	, _copyToClipboardAction(&getWidget(), "Copy")
 	, _saveToCsvAction(&getWidget(),"Save As...")
+    , _computeDERerun(false)
+    , _computeMarkersPending(false)
+    , _preInfoVersion(0)
+    , _postInfoVersion(0)
 {
     setSerializationName(getGuiName());
 
@@ -360,10 +913,34 @@ ClusterDifferentialExpressionPlugin::ClusterDifferentialExpressionPlugin(const m
     _sortFilterProxyModel->setSourceModel(_tableItemModel.get());
     _filterOnIdAction.setSearchMode(true);
     _filterOnIdAction.setClearable(true);
-    _filterOnIdAction.setPlaceHolderString("Filter by ID");
+    _filterOnIdAction.setPlaceHolderString("Filter by ID or paste a list of IDs");
     
     _updateStatisticsAction.setCheckable(false);
     _updateStatisticsAction.setChecked(false);
+
+    _statisticsTileSizeAction.setToolTip("Number of dimensions aggregated per tile when computing the DE_Statistics, 0 sizes the tiles automatically");
+    _sparseDensityThresholdAction.setToolTip("Parent points with a fraction of non-zero values below this threshold are aggregated from a sparse copy");
+    _welchTestAction.setToolTip("Add Welch t-statistic, p-value and Benjamini-Hochberg adjusted p-value columns when two datasets are compared");
+    _rankSumTestAction.setToolTip("Add Wilcoxon rank-sum U, AUROC and p-value columns when two datasets are compared, computed from the raw point values");
+    _rankTestBlockSizeAction.setToolTip("Number of dimensions gathered from the points at once for the rank-sum test, 0 sizes the blocks automatically");
+    _computeMarkersAction.setToolTip("Replace the table by the top markers of every cluster of the first selected dataset, each cluster compared to all its other clusters");
+    _markersPerClusterAction.setToolTip("Number of markers listed per cluster by Compute Cluster Markers");
+    _computePairwiseDEAction.setToolTip("Store the mean differential expression of every pair of clusters of the first selected dataset as a child dataset of its clusters; "
+        "row (i x number of clusters) + j holds cluster i minus cluster j");
+    _pairwiseTopKAction.setToolTip("Number of dimensions with the largest differential expression kept per cluster pair, in DE_PairwiseTopK with their dimension indices in DE_PairwiseTopKDimensions; "
+        "0 stores all dimensions in DE_Pairwise, i.e. clusters x clusters x dimensions values");
+    _topKRowsAction.setToolTip("Number of dimensions with the largest absolute differential expression shown in the table when Show All is off");
+    _showAllRowsAction.setToolTip("Show a row for every dimension instead of only the top K");
+    _autoUpdateDelayAction.setSuffix(" ms");
+    _autoUpdateDelayAction.setToolTip("Time auto update waits for further selection changes before it recomputes, a change within this time restarts the wait");
+    _resultHistorySizeAction.setSuffix(" MB");
+    _resultHistorySizeAction.setToolTip("Maximum memory of the recently shown tables kept to switch back to a recent selection without computing it again; 0 disables the history");
+    _resultHistoryUsageAction.setToolTip("Number of tables in the result history and the memory they take");
+    _resultHistoryUsageAction.setDefaultWidgetFlags(StringAction::Label);
+    _statisticsDiskCacheSizeAction.setSuffix(" MB");
+    _streamingChunkRowsAction.setToolTip("Number of point rows read at once when the DE_Statistics are computed in one streaming pass over the points, "
+        "which needs no per-thread partial sums and reads every row only once; 0 aggregates in dimension tiles instead");
+    _statisticsDiskCacheSizeAction.setToolTip("Maximum size of the local cache of computed DE_Statistics, the least recently used entries are removed first; 0 disables the cache");
     
     
     publishAndSerializeAction(&_preInfoVariantAction);
@@ -372,8 +949,24 @@ ClusterDifferentialExpressionPlugin::ClusterDifferentialExpressionPlugin(const m
     publishAndSerializeAction(&_selectedIdAction);
     publishAndSerializeAction(&_selectedDimensionAction);
     publishAndSerializeAction(&_updateStatisticsAction);
+    publishAndSerializeAction(&_statisticsTileSizeAction);
+    publishAndSerializeAction(&_sparseDensityThresholdAction);
+    publishAndSerializeAction(&_welchTestAction);
+    publishAndSerializeAction(&_rankSumTestAction);
+    publishAndSerializeAction(&_rankTestBlockSizeAction);
+    publishAndSerializeAction(&_statisticsDiskCacheSizeAction);
+    publishAndSerializeAction(&_streamingChunkRowsAction);
+    publishAndSerializeAction(&_computeMarkersAction);
+    publishAndSerializeAction(&_markersPerClusterAction);
+    publishAndSerializeAction(&_computePairwiseDEAction);
+    publishAndSerializeAction(&_pairwiseTopKAction);
+    publishAndSerializeAction(&_topKRowsAction);
+    publishAndSerializeAction(&_showAllRowsAction);
+    publishAndSerializeAction(&_resultHistorySizeAction);
+    publishAndSerializeAction(&_resultHistoryUsageAction, false);
     publishAndSerializeAction(&_infoTextAction);
     publishAndSerializeAction(&_autoUpdateAction);
+    publishAndSerializeAction(&_autoUpdateDelayAction);
     publishAndSerializeAction(&_commandAction);
     publishAndSerializeAction(&_pairwiseDiffExpResultsAction, false);
     serializeAction(&_primaryToolbarAction);
@@ -389,6 +982,7 @@ ClusterDifferentialExpressionPlugin::ClusterDifferentialExpressionPlugin(const m
                 qDebug() << it.key() << " " << it->toMap().size();
             }
 #endif
+            ++_preInfoVersion;
             _tableItemModel->invalidate();
 
     });
@@ -402,6 +996,7 @@ ClusterDifferentialExpressionPlugin::ClusterDifferentialExpressionPlugin(const m
                     qDebug() << it.key() << " " << it->toMap().size();
                 }
 #endif
+            ++_postInfoVersion;
             _tableItemModel->invalidate();
 
         });
@@ -416,13 +1011,70 @@ ClusterDifferentialExpressionPlugin::ClusterDifferentialExpressionPlugin(const m
             
         });
 	
+    connect(&_welchTestAction, &ToggleAction::toggled, [this](bool)
+        {
+            _tableItemModel->invalidate();
+        });
+
+    connect(&_rankSumTestAction, &ToggleAction::toggled, [this](bool)
+        {
+            _tableItemModel->invalidate();
+        });
+
+    connect(&_showAllRowsAction, &ToggleAction::toggled, [this](bool)
+        {
+            _tableItemModel->invalidate();
+        });
+
+    connect(&_topKRowsAction, &IntegralAction::valueChanged, [this](std::int32_t)
+        {
+            if (!_showAllRowsAction.isChecked())
+                _tableItemModel->invalidate();
+        });
+
+    _statisticsDiskCache.setDirectory(QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation)).filePath("DE_Statistics"));
+    _statisticsDiskCache.setMaximumSize(qint64(_statisticsDiskCacheSizeAction.getValue()) << 20);
+    connect(&_statisticsDiskCacheSizeAction, &IntegralAction::valueChanged, [this](std::int32_t value)
+        {
+            _statisticsDiskCache.setMaximumSize(qint64(value) << 20);
+        });
+
+    _resultHistory.setMaximumMemory(std::size_t(_resultHistorySizeAction.getValue()) << 20);
+    updateResultHistoryUsage();
+    connect(&_resultHistorySizeAction, &IntegralAction::valueChanged, [this](std::int32_t value)
+        {
+            _resultHistory.setMaximumMemory(std::size_t(value) << 20);
+            updateResultHistoryUsage();
+        });
+
+    _autoUpdateTimer.setSingleShot(true);
+    connect(&_autoUpdateTimer, &QTimer::timeout, this, &ClusterDifferentialExpressionPlugin::computeDE);
+    connect(&_autoUpdateAction, &ToggleAction::toggled, [this](bool toggled)
+        {
+            if (!toggled)
+                _autoUpdateTimer.stop();
+        });
+
     connect(&_filterOnIdAction, &mv::gui::StringAction::stringChanged, _sortFilterProxyModel, &cde::SortFilterProxyModel::nameFilterChanged);
     connect(&_updateStatisticsAction, &mv::gui::TriggerAction::triggered, this, &ClusterDifferentialExpressionPlugin::computeDE);
+    connect(&_computeMarkersAction, &mv::gui::TriggerAction::triggered, this, &ClusterDifferentialExpressionPlugin::computeMarkers);
+    connect(&_computePairwiseDEAction, &mv::gui::TriggerAction::triggered, this, &ClusterDifferentialExpressionPlugin::computePairwiseDE);
     
     _primaryToolbarAction.addAction(&_loadedDatasetsAction, 2);
 
     _autoUpdateAction.setIcon(mv::util::StyledIcon("check"));
     _primaryToolbarAction.addAction(&_autoUpdateAction, 100);
+    _primaryToolbarAction.addAction(&_autoUpdateDelayAction, 100);
+    _primaryToolbarAction.addAction(&_welchTestAction, 50);
+    _primaryToolbarAction.addAction(&_rankSumTestAction, 50);
+    _primaryToolbarAction.addAction(&_showAllRowsAction, 45);
+    _primaryToolbarAction.addAction(&_topKRowsAction, 45);
+    _primaryToolbarAction.addAction(&_resultHistorySizeAction, 35);
+    _primaryToolbarAction.addAction(&_resultHistoryUsageAction, 35);
+    _primaryToolbarAction.addAction(&_computeMarkersAction, 40);
+    _primaryToolbarAction.addAction(&_markersPerClusterAction, 40);
+    _primaryToolbarAction.addAction(&_computePairwiseDEAction, 30);
+    _primaryToolbarAction.addAction(&_pairwiseTopKAction, 30);
 
     _meanExpressionDatasetGuidAction.reserve(_loadedDatasetsAction.size());
     _DE_StatisticsDatasetGuidAction.reserve(_loadedDatasetsAction.size());
@@ -432,11 +1084,30 @@ ClusterDifferentialExpressionPlugin::ClusterDifferentialExpressionPlugin(const m
     }
 
     connect(&_commandAction, &VariantAction::variantChanged, this, &ClusterDifferentialExpressionPlugin::newCommandsReceived);
+
+    _eventListener.addSupportedEventType(static_cast<std::uint32_t>(EventType::DatasetDataChanged));
+    _eventListener.addSupportedEventType(static_cast<std::uint32_t>(EventType::DatasetAboutToBeRemoved));
+    _eventListener.registerDataEventByType(PointType, std::bind(&ClusterDifferentialExpressionPlugin::onDataEvent, this, std::placeholders::_1));
+    _eventListener.registerDataEventByType(ClusterType, std::bind(&ClusterDifferentialExpressionPlugin::onDataEvent, this, std::placeholders::_1));
     connect(&_loadedDatasetsAction, &LoadedDatasetsAction::datasetAdded, this, &ClusterDifferentialExpressionPlugin::datasetAdded);
+    connect(&_computeDEWatcher, &QFutureWatcher<std::shared_ptr<DEResult>>::finished, this, &ClusterDifferentialExpressionPlugin::computeDEFinished);
+    connect(&_statisticsUpdateWatcher, &QFutureWatcher<bool>::finished, this, &ClusterDifferentialExpressionPlugin::statisticsUpdateFinished);
+    connect(&_batchWatcher, &QFutureWatcher<void>::finished, this, &ClusterDifferentialExpressionPlugin::batchJobFinished);
 
     //_selectedDatasetsAction.setOptionsModel(&_loadedDatasetsAction.model());
 }
 
+ClusterDifferentialExpressionPlugin::~ClusterDifferentialExpressionPlugin()
+{
+    // the workers use the progress manager and their jobs, all owned by this plugin
+    cancelComputeDE(false);
+    cancelStatisticsUpdate();
+    cancelBatchJob();
+    _computeDEWatcher.waitForFinished();
+    _statisticsUpdateWatcher.waitForFinished();
+    _batchWatcher.waitForFinished();
+}
+
 QString ClusterDifferentialExpressionPlugin::getOriginalName() const
 {
     return _originalName;
@@ -546,6 +1217,15 @@ void ClusterDifferentialExpressionPlugin::init()
         
 
         connect(_tableItemModel.get(), &QTableItemModel::statusChanged, _buttonProgressBar, &ButtonProgressBar::showStatus);
+        connect(_buttonProgressBar, &ButtonProgressBar::cancelRequested, this, [this]()
+            {
+                cancelComputeDE(false);
+                cancelStatisticsUpdate();
+                cancelBatchJob();
+                _pendingStatisticsRequests.clear();
+                _statisticsContinuations.clear();
+                _pendingBatchRequest = nullptr;
+            });
 
         mainLayout->addWidget(_buttonProgressBar, currentRow, 0);
         mainLayout->setRowStretch(currentRow++, 1);
@@ -748,14 +1428,20 @@ void ClusterDifferentialExpressionPlugin::createMeanExpressionDataset(qsizetype
 
     if(index >=0)
     {
-        assert(_identicalDimensions || (!_matchingDimensionNames.empty()));
+        if (!_dimensionMatching)
+            matchDimensionNames();
 
-        qsizetype de_Statistics_dimension = _identicalDimensions ? index : _matchingDimensionNames[index].second[dataset_index];
+        qsizetype de_Statistics_dimension = _dimensionMatching->identical ? index : _dimensionMatching->index(index, dataset_index);
 
-        if (de_Statistics_dimension >= 0)
+        // without DE_Statistics the mean expressions stay NaN, until the ones being computed are available
+        auto statisticsDatasets = get_DE_Statistics(getDataset(dataset_index), QString("MeanExpression%1").arg(dataset_index), [this, dataset_index, index]()
+            {
+                if (dataset_index < _loadedDatasetsAction.size())
+                    createMeanExpressionDataset(dataset_index, index);
+            });
+        if (statisticsDatasets && (de_Statistics_dimension >= 0) && (de_Statistics_dimension < static_cast<qsizetype>(statisticsDatasets->meansData->getNumDimensions())))
         {
-            auto de_Statistics_clusterDataset = get_DE_Statistics_Dataset(getDataset(dataset_index));
-            const Points* p = de_Statistics_clusterDataset.get();
+            const Points* p = statisticsDatasets->meansData;
             for (qsizetype clusterIndex = 0; clusterIndex < clusters.size(); ++clusterIndex)
             {
                 std::size_t point_index = (clusterIndex * p->getNumDimensions()) + de_Statistics_dimension;
@@ -795,8 +1481,7 @@ void ClusterDifferentialExpressionPlugin::datasetChanged(qsizetype index, const
     
     updateWindowTitle();
 
-    _identicalDimensions = false;
-    _matchingDimensionNames.clear();
+    _dimensionMatching.reset();
 
     
     createMeanExpressionDataset(index, -1);
@@ -810,10 +1495,10 @@ void ClusterDifferentialExpressionPlugin::datasetChanged(qsizetype index, const
             bool condition = true;
             for (qsizetype i = 0; condition && (i < _loadedDatasetsAction.size()); ++i)
             {
-                condition &= (local::clusterDatset_has_computed_DE_Statistics(_loadedDatasetsAction.getDataset(i)));
+                condition &= (find_DE_Statistics(_loadedDatasetsAction.getDataset(i)) != nullptr);
             }
             if (condition)
-                computeDE();
+                scheduleAutoUpdate();
         }
     }
     _tableView->update();
@@ -826,29 +1511,45 @@ void ClusterDifferentialExpressionPlugin::update_pairwiseDiffExpResultsAction(qs
         return;
     const qsizetype NrOfDatasets = _loadedDatasetsAction.size();
 
-    if (!_identicalDimensions)
-        if (_matchingDimensionNames.empty())
+    if (!_dimensionMatching)
+        matchDimensionNames();
+    const cde::DimensionMatching& matching = *_dimensionMatching;
+
+    // the pairs are reported once the DE_Statistics of all selected datasets are available
+    bool computing = false;
+    for (qsizetype i = 0; i < NrOfDatasets; ++i)
+    {
+        if (_loadedDatasetsAction.data(i)->datasetSelectedAction.isChecked())
         {
-            _identicalDimensions = matchDimensionNames();
-            assert(_identicalDimensions || (!_matchingDimensionNames.empty()));
+            const auto continuation = [this, dimension, nameToCheck]() { update_pairwiseDiffExpResultsAction(dimension, nameToCheck); };
+            if (!get_DE_Statistics(getDataset(i), "PairwiseDiffExpResults", continuation) && computingStatistics(getDataset(i)))
+                computing = true;
         }
+    }
+    if (computing)
+        return;
 
     std::vector<QString> unifiedDimensionNames;
-    if (_identicalDimensions)
+    if (matching.identical)
         for (qsizetype i = 0; i < NrOfDatasets; ++i)
         {
             if (_loadedDatasetsAction.data(i)->datasetSelectedAction.isChecked())
             {
-                unifiedDimensionNames = get_DE_Statistics_Dataset(getDataset(0))->getDimensionNames();
+                auto statisticsDatasets = find_DE_Statistics(getDataset(i));
+                if (statisticsDatasets)
+                    unifiedDimensionNames = statisticsDatasets->meansData->getDimensionNames();
                 break;
             }
         }
 
-    const QString dimensionName = _identicalDimensions ? unifiedDimensionNames[dimension] : _matchingDimensionNames[dimension].first;
+    if (dimension < 0 || dimension >= static_cast<qsizetype>(matching.identical ? unifiedDimensionNames.size() : matching.names.size()))
+        return;
+
+    const QString dimensionName = matching.identical ? unifiedDimensionNames[dimension] : matching.names[dimension];
 
     assert(nameToCheck.isEmpty() || (nameToCheck == dimensionName));
 
-    std::vector<std::vector<double>> meanExpressionValues(NrOfDatasets);
+    std::vector<std::shared_ptr<const cde::GroupStatistics>> groupStatistics(NrOfDatasets);
     
     for (qsizetype i = 0; i < NrOfDatasets; ++i)
     {
@@ -856,38 +1557,26 @@ void ClusterDifferentialExpressionPlugin::update_pairwiseDiffExpResultsAction(qs
         {
             QStringList clusterStrings = _loadedDatasetsAction.getClusterOptions(i);
             QStringList clusterSelectionStrings = _loadedDatasetsAction.getClusterSelection(i);
-            meanExpressionValues[i] = computeMeanExpressionsForSelectedClusters(getDataset(i), local::getClusterIndices(clusterStrings, clusterSelectionStrings));
+            groupStatistics[i] = computeStatisticsForSelectedClusters(getDataset(i), local::getClusterIndices(clusterStrings, clusterSelectionStrings));
 
-            auto DE_StatisticsDataset = get_DE_Statistics_Dataset(_loadedDatasetsAction.getDataset(i));
-            if (DE_StatisticsDataset.isValid())
-                _DE_StatisticsDatasetGuidAction[i].data()->setString(DE_StatisticsDataset->getId());
+            auto statisticsDatasets = find_DE_Statistics(_loadedDatasetsAction.getDataset(i));
+            if (statisticsDatasets)
+                _DE_StatisticsDatasetGuidAction[i].data()->setString(statisticsDatasets->meansData->getId());
         }
     }
 
 
+    // datasets without DE_Statistics, or without the dimension, have no mean and are left out of the pairs below
     std::vector<double> mean(NrOfDatasets);
-    if (_identicalDimensions)
-    {
-        for (qsizetype datasetIndex = 0; datasetIndex < NrOfDatasets; ++datasetIndex)
-        {
-            if (_loadedDatasetsAction.data(datasetIndex)->datasetSelectedAction.isChecked())
-            {
-                mean[datasetIndex] = meanExpressionValues[datasetIndex][dimension];
-            }
-        }
-    }
-    else
+    for (qsizetype datasetIndex = 0; datasetIndex < NrOfDatasets; ++datasetIndex)
     {
-        for (qsizetype datasetIndex = 0; datasetIndex < NrOfDatasets; ++datasetIndex)
+        if (_loadedDatasetsAction.data(datasetIndex)->datasetSelectedAction.isChecked())
         {
-            if (_loadedDatasetsAction.data(datasetIndex)->datasetSelectedAction.isChecked())
-            {
-                qsizetype dimensionIndex = _matchingDimensionNames[dimension].second[datasetIndex];
-                if (dimensionIndex >= 0)
-                    mean[datasetIndex] = meanExpressionValues[datasetIndex][dimensionIndex];
-                else
-                    mean[datasetIndex] = std::numeric_limits<double>::quiet_NaN();
-            }
+            const qsizetype dimensionIndex = matching.identical ? dimension : matching.index(dimension, datasetIndex);
+            if (groupStatistics[datasetIndex] && (dimensionIndex >= 0) && (dimensionIndex < static_cast<qsizetype>(groupStatistics[datasetIndex]->mean.size())))
+                mean[datasetIndex] = groupStatistics[datasetIndex]->mean[dimensionIndex];
+            else
+                mean[datasetIndex] = std::numeric_limits<double>::quiet_NaN();
         }
     }
     
@@ -945,13 +1634,13 @@ void ClusterDifferentialExpressionPlugin::clusterSelectionChanged(const QStringL
         bool condition = true;
         for (qsizetype i = 0; condition && (i < _loadedDatasetsAction.size()); ++i)
         {
-            condition &= (local::clusterDatset_has_computed_DE_Statistics(_loadedDatasetsAction.getDataset(i)));
+            condition &= (find_DE_Statistics(_loadedDatasetsAction.getDataset(i)) != nullptr);
         }
         if (condition)
         {
             if (_tableItemModel)
                 _tableItemModel->invalidate();
-            computeDE();
+            scheduleAutoUpdate();
             return;
         }
     }
@@ -1107,7 +1796,13 @@ void ClusterDifferentialExpressionPlugin::tableView_clicked(const QModelIndex& i
         QString selectedGeneName = firstColumn.data().toString();
         QModelIndex temp = _sortFilterProxyModel->mapToSource(firstColumn);
         auto row = temp.row();
-       _selectedIdAction.setString(selectedGeneName);
+        if (!_tableRowDimensions.empty())
+        {
+            row = _tableRowDimensions[row];
+            if (row < 0)
+                return;
+        }
+       _selectedIdAction.setString(selectedGeneName);
 	   auto dimensions = _selectedDimensionAction.getOptions();
        if (dimensions.contains(selectedGeneName))
        {
@@ -1259,21 +1954,17 @@ void ClusterDifferentialExpressionPlugin::newCommandsReceived(const QVariant& va
 }
 
 
-bool ClusterDifferentialExpressionPlugin::matchDimensionNames()
+void ClusterDifferentialExpressionPlugin::matchDimensionNames()
 {
-    _matchingDimensionNames.clear();
-
     const qsizetype nrOfDatasets = _loadedDatasetsAction.size();
 
     std::vector<std::vector<QString>> dimensionNames(nrOfDatasets);
-    std::vector<QVector<QString>> sortedDimensionNames(nrOfDatasets);
-
-    //#pragma omp parallel for schedule(dynamic, 1)
     for(qsizetype datasetIndex=0; datasetIndex < nrOfDatasets; ++datasetIndex)
     {
-        if (local::clusterDatset_has_computed_DE_Statistics(getDataset(0)))
+        auto statisticsDatasets = find_DE_Statistics(getDataset(datasetIndex));
+        if (statisticsDatasets)
         {
-            dimensionNames[datasetIndex] = get_DE_Statistics_Dataset(getDataset(datasetIndex))->getDimensionNames();
+            dimensionNames[datasetIndex] = statisticsDatasets->meansData->getDimensionNames();
         }
         else
         {
@@ -1281,281 +1972,579 @@ bool ClusterDifferentialExpressionPlugin::matchDimensionNames()
             if (parentDataset.isValid())
                 dimensionNames[datasetIndex] = parentDataset->getDimensionNames();
         }
-        sortedDimensionNames[datasetIndex]= std::move(QVector<QString>(dimensionNames[datasetIndex].cbegin(), dimensionNames[datasetIndex].cend()));
+    }
 
-#if defined(__cpp_lib_parallel_algorithm)
-        std::sort(std::execution::par_unseq, sortedDimensionNames[datasetIndex].begin(), sortedDimensionNames[datasetIndex].end());
-#else
-        std::sort(sortedDimensionNames[datasetIndex].begin(), sortedDimensionNames[datasetIndex].end());
-#endif
+    _dimensionMatching = _dimensionMatchingCache.find(dimensionNames);
+    if (!_dimensionMatching)
+    {
+        _dimensionMatching = std::make_shared<const cde::DimensionMatching>(cde::matchDimensionNames(dimensionNames));
+        _dimensionMatchingCache.insert(dimensionNames, _dimensionMatching);
     }
+}
+
+
+
+std::shared_ptr<const DE_StatisticsDatasets> ClusterDifferentialExpressionPlugin::find_DE_Statistics(mv::Dataset<Clusters> clusterDataset)
+{
+    if (!clusterDataset.isValid())
+        return nullptr;
 
-    bool identicalOrder = true;
-    std::size_t totalNumberOfDimensions = dimensionNames[0].size();
-    for (qsizetype datasetIndex = 1; datasetIndex < nrOfDatasets; ++datasetIndex)
+    const QString clusterDatasetId = clusterDataset->getId();
+    auto found = _DE_StatisticsDatasets.constFind(clusterDatasetId);
+    if (found != _DE_StatisticsDatasets.constEnd())
+        return found.value();
+
+    // only existing DE_Statistics are cached, until then every lookup goes through the data hierarchy
+    auto datasets = std::make_shared<const DE_StatisticsDatasets>(local::findStatisticsDatasets(clusterDataset));
+    if (!datasets->means.isValid())
+        return nullptr;
+
+    _DE_StatisticsDatasets.insert(clusterDatasetId, datasets);
+    return datasets;
+}
+
+std::shared_ptr<const DE_StatisticsDatasets> ClusterDifferentialExpressionPlugin::get_DE_Statistics(mv::Dataset<Clusters> clusterDataset, const QString& continuationKey, std::function<void()> continuation)
+{
+    // DE_Statistics stored without the sibling variance, non-zero fraction and cluster size datasets are completed once
+    auto datasets = find_DE_Statistics(clusterDataset);
+    if (datasets && datasets->hasSiblings())
+        return datasets;
+
+    mv::Dataset<Points> points = local::findParentPoints(clusterDataset);
+    if (!points.isValid())
+        return datasets;
+
+    _statisticsContinuations.insert(continuationKey, std::move(continuation));
+    requestClusterStatistics(clusterDataset);
+    return nullptr;
+}
+
+void ClusterDifferentialExpressionPlugin::requestClusterStatistics(mv::Dataset<Clusters> clusterDataset)
+{
+    if (computingStatistics(clusterDataset))
+        return;
+
+    // computed meanwhile, e.g. by computeDE
+    auto datasets = find_DE_Statistics(clusterDataset);
+    if (datasets && datasets->hasSiblings())
     {
-        identicalOrder &= (dimensionNames[0] == dimensionNames[datasetIndex]);
-        totalNumberOfDimensions += dimensionNames[datasetIndex].size();
+        runStatisticsContinuations();
+        return;
     }
-    if (identicalOrder)
+
+    // one worker at a time, the request is handled once the running one has finished
+    if (_computeDEWatcher.isRunning() || _statisticsUpdateWatcher.isRunning())
+    {
+        _pendingStatisticsRequests.insert(clusterDataset->getId(), clusterDataset);
+        return;
+    }
+
+    mv::Dataset<Points> points = local::findParentPoints(clusterDataset);
+    if (points.isValid())
+        startStatisticsJob(clusterDataset, points, cde::clusterMembers(clusterDataset->getClusters()), true);
+}
+
+bool ClusterDifferentialExpressionPlugin::computingStatistics(mv::Dataset<Clusters> clusterDataset) const
+{
+    const QString clusterDatasetId = clusterDataset->getId();
+    if (_pendingStatisticsRequests.contains(clusterDatasetId))
         return true;
+    return _statisticsUpdateWatcher.isRunning() && _statisticsUpdateJob && _statisticsUpdateJob->store
+        && _statisticsUpdateJob->clusterDataset.isValid() && (_statisticsUpdateJob->clusterDataset->getId() == clusterDatasetId);
+}
+
+void ClusterDifferentialExpressionPlugin::runStatisticsContinuations()
+{
+    const QHash<QString, std::function<void()>> continuations = std::move(_statisticsContinuations);
+    _statisticsContinuations.clear();
+    for (const auto& continuation : continuations)
+        continuation();
+}
+
+void ClusterDifferentialExpressionPlugin::trackClusterStatistics(mv::Dataset<Clusters> clusterDataset, cde::ClusterStatistics&& statistics, std::vector<cde::ClusterMember>&& members)
+{
+    auto tracked = std::make_shared<cde::TrackedClusterStatistics>();
+    tracked->statistics = std::move(statistics);
+    tracked->members = std::move(members);
+    _trackedStatistics.insert(clusterDataset->getId(), tracked);
 
-    QVector<QString> allDimensionNames = sortedDimensionNames[0];
-    for (qsizetype datasetIndex = 1; datasetIndex < nrOfDatasets; ++datasetIndex)
+    // the clusters may have changed since the statistics were computed
+    updateClusterStatistics(clusterDataset);
+}
+
+void ClusterDifferentialExpressionPlugin::updateClusterStatistics(mv::Dataset<Clusters> clusterDataset)
+{
+    const QString clusterDatasetId = clusterDataset->getId();
+    std::shared_ptr<cde::TrackedClusterStatistics> tracked = _trackedStatistics.value(clusterDatasetId);
+    if (!tracked)
+        return;
+
+    const auto& clusters = clusterDataset->getClusters();
+    std::vector<cde::ClusterMember> members = cde::clusterMembers(clusters);
+    const cde::MembershipDelta delta = cde::membershipDelta(tracked->members, members);
+    if (delta.size() == 0)
+        return;
+
+    auto datasets = find_DE_Statistics(clusterDataset);
+    mv::Dataset<Points> points = local::findParentPoints(clusterDataset);
+    if (!datasets || !points.isValid() || (points->getNumDimensions() != tracked->statistics.numDimensions))
     {
-        QVector<QString>result;
-#if defined(__cpp_lib_parallel_algorithm)
-        std::merge(std::execution::par_unseq, allDimensionNames.cbegin(), allDimensionNames.cend(), sortedDimensionNames[datasetIndex].cbegin(), sortedDimensionNames[datasetIndex].cend(), result.begin());
-        auto dummy = std::unique(std::execution::par_unseq, result.begin(), result.end());
-#else
-        std::merge(allDimensionNames.cbegin(), allDimensionNames.cend(), sortedDimensionNames[datasetIndex].cbegin(), sortedDimensionNames[datasetIndex].cend(), result.begin());
-        std::unique(result.begin(), result.end());
-#endif
-        allDimensionNames = std::move(result);
+        _trackedStatistics.remove(clusterDatasetId);
+        return;
     }
 
-    std::vector<std::vector<QString>::const_iterator> begin(nrOfDatasets);
-    std::vector<std::vector<QString>::const_iterator> end(nrOfDatasets);
-    #pragma omp parallel for
-    for(qsizetype datasetIndex=0; datasetIndex < nrOfDatasets; ++datasetIndex)
+    // a running computation may be reading the tables that are about to be replaced, they are updated once it has stopped and it is restarted then;
+    // a running update of the statistics is followed by this one
+    if (_computeDEWatcher.isRunning() || _statisticsUpdateWatcher.isRunning())
     {
-        begin[datasetIndex] = dimensionNames[datasetIndex].begin();
-        end[datasetIndex] = dimensionNames[datasetIndex].end();
+        if (!_pendingStatisticsUpdates.contains(clusterDatasetId))
+            _pendingStatisticsUpdates.insert(clusterDatasetId, clusterDataset);
+        cancelComputeDE(true);
+        return;
     }
 
-    _matchingDimensionNames.resize(allDimensionNames.size());
-    _progressManager.start(allDimensionNames.size(), "Matching Dimensions");
-    #pragma  omp parallel for schedule(dynamic,1)
-    for(qsizetype i=0; i < allDimensionNames.size(); ++i)
+    // only the moved rows are read, unless that is more than reading all cluster members again, which is done on a worker thread
+    if (delta.size() >= members.size())
     {
-        const QString name = allDimensionNames[i];
-        _matchingDimensionNames[i].first = name;
-        QVector<qsizetype>& value = _matchingDimensionNames[i].second;
-        value.resize(nrOfDatasets, -1);
-        for (qsizetype datasetIndex = 0; datasetIndex < nrOfDatasets; ++datasetIndex)
-        {
-#if defined(__cpp_lib_parallel_algorithm)
-            auto found  = std::find(std::execution::par_unseq, begin[datasetIndex], end[datasetIndex],name);
-#else
-            auto found = std::find(begin[datasetIndex], end[datasetIndex], name);
-#endif
-            if(found != end[datasetIndex])
-            {
-                value[datasetIndex] = found - begin[datasetIndex];
-            }
-        }
-        _progressManager.print(i);
+        startStatisticsJob(clusterDataset, points, std::move(members), false);
+        return;
     }
-    
-    _progressManager.end();
 
-    return false;
+    local::applyClusterMembershipDelta(*points, delta, clusters.size(), tracked->statistics);
+    tracked->members = std::move(members);
+    publishClusterStatistics(clusterDataset, *datasets, *tracked);
+}
+
+void ClusterDifferentialExpressionPlugin::startStatisticsJob(mv::Dataset<Clusters> clusterDataset, mv::Dataset<Points> points, std::vector<cde::ClusterMember>&& members, bool store)
+{
+    _statisticsUpdateJob = std::make_unique<StatisticsUpdateJob>();
+    StatisticsUpdateJob* job = _statisticsUpdateJob.get();
+    job->clusterDataset = clusterDataset;
+    job->points = points.get();
+    job->pointsId = points->getId();
+    job->clusters = clusterDataset->getClusters();
+    job->members = std::move(members);
+    job->dimensionNames = points->getDimensionNames();
+    job->message = QString("Computing DE Statistics for %1 - %2").arg(points->getGuiName(), clusterDataset->getGuiName()).toStdString();
+    job->store = store;
+    job->tileSize = _statisticsTileSizeAction.getValue();
+    job->streamingChunkRows = _streamingChunkRowsAction.getValue();
+    job->sparseDensityThreshold = _sparseDensityThresholdAction.getValue();
+    _statisticsUpdateWatcher.setFuture(QtConcurrent::run([this, job]() { return computeStatisticsUpdate(*job); }));
 }
 
+bool ClusterDifferentialExpressionPlugin::computeStatisticsUpdate(StatisticsUpdateJob& job)
+{
+    // a single stage, so a job cancelled while queued behind another computation stops waiting
+    ProgressTask progressTask(_progressManager, QString::fromStdString(job.message), { { QString::fromStdString(job.message), 1.0 } }, &job.cancelled);
+    progressTask.beginStage(0);
+    return local::computeCachedClusterStatistics(*job.points, job.clusters, job.dimensionNames, job.sparseDensityThreshold, job.tileSize, job.streamingChunkRows, job.message, _progressManager, &job.cancelled, _statisticsDiskCache, job.statistics);
+}
 
+void ClusterDifferentialExpressionPlugin::cancelStatisticsUpdate()
+{
+    if (!_statisticsUpdateWatcher.isRunning() || !_statisticsUpdateJob)
+        return;
 
+    _statisticsUpdateJob->cancelled = true;
+    _progressManager.setCanceled(true);
+}
 
-std::ptrdiff_t ClusterDifferentialExpressionPlugin::get_DE_Statistics_Index(mv::Dataset<Clusters> clusterDataset)
+void ClusterDifferentialExpressionPlugin::statisticsUpdateFinished()
 {
-    std::ptrdiff_t child_DE_Statistics_DatasetIndex = -1;
-    
-    // check if the basic DE_Statistics for the cluster dataset has already been computed
-   
-    const QString child_DE_Statistics_DatasetName = "DE_Statistics";
+    _progressManager.setCanceled(false);
+
+    std::unique_ptr<StatisticsUpdateJob> job = std::move(_statisticsUpdateJob);
+    if (!job)
+        return;
+
+    const bool computed = _statisticsUpdateWatcher.result() && !job->cancelled;
+    if (job->clusterDataset.isValid())
     {
-        const auto& childDatasets = clusterDataset->getChildren({ PointType });
-        for (qsizetype i = 0; i < childDatasets.size(); ++i)
+        const QString clusterDatasetId = job->clusterDataset->getId();
+        if (job->store)
         {
-            if (childDatasets[i]->getGuiName() == child_DE_Statistics_DatasetName)
+            if (computed)
             {
-                child_DE_Statistics_DatasetIndex = i;
-                break;
+                local::storeClusterStatistics(job->clusterDataset, job->dimensionNames, job->statistics);
+                _DE_StatisticsDatasets.remove(clusterDatasetId);
+                trackClusterStatistics(job->clusterDataset, std::move(job->statistics), std::move(job->members));
+            }
+            else if (job->restart)
+            {
+                _pendingStatisticsRequests.insert(clusterDatasetId, job->clusterDataset);
+            }
+        }
+        else
+        {
+            std::shared_ptr<cde::TrackedClusterStatistics> tracked = _trackedStatistics.value(clusterDatasetId);
+            auto datasets = find_DE_Statistics(job->clusterDataset);
+
+            // incomplete statistics cannot be updated incrementally anymore, they are computed again when needed
+            if (!computed)
+            {
+                _trackedStatistics.remove(clusterDatasetId);
+            }
+            else if (tracked && datasets)
+            {
+                tracked->statistics = std::move(job->statistics);
+                tracked->members = std::move(job->members);
+                publishClusterStatistics(job->clusterDataset, *datasets, *tracked);
             }
         }
     }
 
-    // if they are not available compute them now
-    if (child_DE_Statistics_DatasetIndex < 0)
+    // what was waiting for cancelled DE_Statistics is dropped with them
+    if (job->store && !computed && !job->restart)
+        _statisticsContinuations.clear();
+
+    processPendingStatisticsUpdates();
+
+    if (job->store && computed)
+        runStatisticsContinuations();
+
+    // computeDE waited for the updated statistics
+    if (_computeDERerun && !_statisticsUpdateWatcher.isRunning())
     {
-        const auto& clusters = clusterDataset->getClusters();
-        const auto numClusters = clusters.size();
+        _computeDERerun = false;
+        computeDE();
+    }
+}
 
-        mv::Dataset<Points> points;
-        DataHierarchyItems parents = clusterDataset->getDataHierarchyItem().getAncestors();
-        for(auto parent : parents )
+void ClusterDifferentialExpressionPlugin::publishClusterStatistics(mv::Dataset<Clusters> clusterDataset, const DE_StatisticsDatasets& datasets, const cde::TrackedClusterStatistics& tracked)
+{
+    const QString clusterDatasetId = clusterDataset->getId();
+    local::updateStatisticsDatasets(datasets, tracked.statistics);
+
+    for (qsizetype i = 0; i < _loadedDatasetsAction.size(); ++i)
+    {
+        if (_loadedDatasetsAction.getDataset(i).isValid() && (_loadedDatasetsAction.getDataset(i)->getId() == clusterDatasetId))
         {
-            points = parent->getDataset<Points>();
-            if(points.isValid())
-                break;
+            _tableItemModel->invalidate();
+            break;
         }
-        if (!points.isValid())
-            return child_DE_Statistics_DatasetIndex; // return -1
-
-        //mv::Dataset<Points> points = clusterDataset->getParent<Points>();
-        const std::ptrdiff_t numDimensions = points->getNumDimensions();
+    }
+}
 
-        //compute the DE statistics for this cluster
+void ClusterDifferentialExpressionPlugin::stopWorkersReadingPoints(const QString& pointsId, bool rerun)
+{
+    if (_computeDEWatcher.isRunning() && _computeDEJob)
+    {
+        const auto readsPoints = [&pointsId](const DEJob::Input& input) { return (input.points != nullptr) && (input.pointsId == pointsId); };
+        if (std::any_of(_computeDEJob->inputs.cbegin(), _computeDEJob->inputs.cend(), readsPoints))
+        {
+            _computeDEJob->inputsChanged = true;
+            cancelComputeDE(rerun);
+            _computeDEWatcher.waitForFinished();
+        }
+    }
 
-        const auto numPoints = points->getNumPoints();
+    // a cancelled update drops the tracked statistics, they are computed again when needed; new DE_Statistics are requested again
+    if (_statisticsUpdateWatcher.isRunning() && _statisticsUpdateJob && (_statisticsUpdateJob->pointsId == pointsId))
+    {
+        _statisticsUpdateJob->restart = rerun;
+        cancelStatisticsUpdate();
+        _statisticsUpdateWatcher.waitForFinished();
+    }
+}
 
-        std::vector<float> meanExpressions(numClusters * numDimensions, 0);
+void ClusterDifferentialExpressionPlugin::processPendingStatisticsUpdates()
+{
+    const QHash<QString, mv::Dataset<Clusters>> pending = std::move(_pendingStatisticsUpdates);
+    _pendingStatisticsUpdates.clear();
+    for (const auto& clusterDataset : pending)
+    {
+        if (clusterDataset.isValid())
+            updateClusterStatistics(clusterDataset);
+    }
 
-        int x = omp_get_max_threads();
-        int y = omp_get_num_threads();
+    const QHash<QString, mv::Dataset<Clusters>> requests = std::move(_pendingStatisticsRequests);
+    _pendingStatisticsRequests.clear();
+    for (const auto& clusterDataset : requests)
+    {
+        if (clusterDataset.isValid())
+            requestClusterStatistics(clusterDataset);
+    }
+}
 
-        std::string message = QString("Computing DE Statistics for %1 - %2").arg(points->getGuiName(),clusterDataset->getGuiName()).toStdString();
-        _progressManager.start(numDimensions, message);
-        points->visitData([this, &clusters, &meanExpressions, numClusters, numDimensions](auto vec)
-            {
-                
-                #pragma omp parallel for schedule(dynamic, 1)
-                for (int dimension = 0; dimension < numDimensions; ++dimension)
-                {
-                    //#pragma omp parallel for schedule(dynamic, 1)
-                    for (std::ptrdiff_t clusterIdx = 0; clusterIdx < numClusters; ++clusterIdx)
-                    {
-                        const auto& cluster = clusters[clusterIdx];
-                        const auto& clusterIndices = cluster.getIndices();
-                        std::size_t offset = (clusterIdx * numDimensions) + dimension;
-                        for (auto row : clusterIndices)
-                        {
-                            meanExpressions[offset] += vec[row][dimension];
-                        }
-                        meanExpressions[offset] /= clusterIndices.size();
-                    }
-                    _progressManager.print(dimension);
-                }
-            });
-        
 
-        
-        mv::Dataset<Points> newDataset = mv::data().createDataset("Points", child_DE_Statistics_DatasetName, clusterDataset);
+void ClusterDifferentialExpressionPlugin::onDataEvent(mv::DatasetEvent* dataEvent)
+{
+    switch (dataEvent->getType())
+    {
+        case EventType::DatasetDataChanged:
+        case EventType::DatasetAboutToBeRemoved:
+        {
+            const QString datasetId = dataEvent->getDataset()->getId();
 
-        events().notifyDatasetAdded(newDataset);
-        
-        newDataset->setDataElementType<float>();
-        newDataset->setData(std::move(meanExpressions), numDimensions);
-        newDataset->setDimensionNames(points->getDimensionNames());
-        
-        events().notifyDatasetDataChanged(newDataset);
-       
+            // the workers read the points directly, they have to stop before the points change or go away
+            if (dataEvent->getDataset()->getDataType() == PointType)
+                stopWorkersReadingPoints(datasetId, dataEvent->getType() == EventType::DatasetDataChanged);
 
-        // now fild the child indices for this dataset
-        child_DE_Statistics_DatasetIndex = -1;
-        {
-            const auto& childDatasets = clusterDataset->getChildren({ PointType });
-            for (qsizetype i = 0; i < childDatasets.size(); ++i)
+            if (dataEvent->getDataset()->getDataType() == ClusterType)
             {
-                if (childDatasets[i]->getGuiName() == child_DE_Statistics_DatasetName)
+                if (dataEvent->getType() == EventType::DatasetDataChanged)
+                {
+                    updateClusterStatistics(dataEvent->getDataset());
+                }
+                else
                 {
-                    child_DE_Statistics_DatasetIndex = i;
-                    break;
+                    _trackedStatistics.remove(datasetId);
+                    _pendingStatisticsUpdates.remove(datasetId);
+                    _pendingStatisticsRequests.remove(datasetId);
                 }
             }
+
+            // the resolved DE_Statistics of a changed cluster dataset, or the ones the changed dataset belongs to, are looked up again
+            _DE_StatisticsDatasets.remove(datasetId);
+            _DE_StatisticsDatasets.removeIf([&datasetId](decltype(_DE_StatisticsDatasets)::iterator entry)
+                {
+                    const DE_StatisticsDatasets& datasets = *entry.value();
+                    for (const auto* dataset : { &datasets.means, &datasets.variances, &datasets.nonZeroFractions, &datasets.clusterSizes })
+                    {
+                        if (dataset->isValid() && ((*dataset)->getId() == datasetId))
+                            return true;
+                    }
+                    return false;
+                });
+            break;
         }
+        default:
+            break;
     }
-
-    _progressManager.end();
-    return child_DE_Statistics_DatasetIndex;
 }
 
-
-Dataset<Points> ClusterDifferentialExpressionPlugin::get_DE_Statistics_Dataset(mv::Dataset<Clusters> clusterDataset)
+std::shared_ptr<const cde::GroupStatistics> ClusterDifferentialExpressionPlugin::computeStatisticsForSelectedClusters(mv::Dataset<Clusters> clusterDataset, const QSet<unsigned>& selected_clusters)
 {
-    auto clusterDataset_DE_Statitstics_Index = get_DE_Statistics_Index(clusterDataset);
-    assert(clusterDataset_DE_Statitstics_Index >= 0);
-    const auto& clusterDataset_Children = clusterDataset->getChildren({ PointType });
-    Dataset<Points> DE_Statistics = clusterDataset_Children[clusterDataset_DE_Statitstics_Index];
-    return DE_Statistics;
-}
+    auto datasets = find_DE_Statistics(clusterDataset);
+    if (!datasets)
+        return nullptr;
 
-std::vector<double> ClusterDifferentialExpressionPlugin::computeMeanExpressionsForSelectedClusters(mv::Dataset<Clusters> clusterDataset, const QSet<unsigned>& selected_clusters)
-{
+    std::vector<unsigned> selectedClusters(selected_clusters.cbegin(), selected_clusters.cend());
+    std::sort(selectedClusters.begin(), selectedClusters.end());
 
-   
-    
-    std::vector<double> meanExpressions_cluster1;
-    auto clusterDataset_DE_Statitstics_Index = get_DE_Statistics_Index(clusterDataset);
-    if (clusterDataset_DE_Statitstics_Index < 0)
-        return meanExpressions_cluster1;
+    // computeDE pooled the same selection already, unless the DE_Statistics were replaced since
+    if (auto cached = _groupStatisticsCache.find(clusterDataset->getId(), selectedClusters, datasets))
+        return cached;
 
-    const auto& clusterDataset_Children = clusterDataset->getChildren({ PointType });
-    Dataset<Points> DE_Statistics = clusterDataset_Children[clusterDataset_DE_Statitstics_Index];
+    local::StoredClusterTables stored;
+    if (!local::readClusterTables(*datasets, clusterDataset->getClusters(), stored))
+        return nullptr;
 
-    const auto& clusters = clusterDataset->getClusters();
-    auto numDimensions = DE_Statistics->getNumDimensions();
+    auto result = std::make_shared<const cde::GroupStatistics>(cde::poolClusters(stored.tables, selectedClusters));
+    _groupStatisticsCache.insert(clusterDataset->getId(), selectedClusters, datasets, result);
+    return result;
+}
 
-    //_progressManager.start((numDimensions * selected_clusters.size()) + numDimensions, QString("Computing Mean Expressions for %1").arg(clusterDataset->getGuiName()).toStdString());
-    meanExpressions_cluster1.assign(numDimensions,0);
-    { // for each selected cluster in selection 1
-        std::size_t sumOfClusterSizes = 0;
-        std::size_t numProcessedClusters = 0;
-        for (auto clusterIdx : selected_clusters)
+std::vector<cde::RankSumResult> ClusterDifferentialExpressionPlugin::computeRankSumTests(const DEJob& job, const DEResult& result, std::ptrdiff_t numDimensions)
+{
+    std::vector<std::uint32_t> rows[2];
+    for (int group = 0; group < 2; ++group)
+    {
+        const DEJob::Input& input = job.inputs[job.testDatasets[group]];
+        for (auto clusterIdx : input.selectedClusters)
         {
-            const auto& cluster = clusters[clusterIdx];
-            auto clusterName = cluster.getName();
-            const auto clusterSize = cluster.getIndices().size();
+            const auto& clusterIndices = input.clusters[clusterIdx].getIndices();
+            rows[group].insert(rows[group].end(), clusterIndices.cbegin(), clusterIndices.cend());
+        }
+        // gather in storage order
+        std::sort(rows[group].begin(), rows[group].end());
+    }
 
-            const std::size_t clusterIndexOffset = clusterIdx * numDimensions;
-#pragma omp parallel for schedule(dynamic,1)
-            for (std::ptrdiff_t dimension = 0; dimension < numDimensions; ++dimension)
-            {
+    const std::size_t blockSize = cde::resolveRankBlockSize(rows[0].size() + rows[1].size(), numDimensions, job.rankBlockSize);
+    const std::size_t numBlocks = cde::tileCount(numDimensions, blockSize);
 
-                meanExpressions_cluster1[dimension] += DE_Statistics->getValueAt(clusterIndexOffset + dimension) * clusterSize;
-   //            _progressManager.print(  (numProcessedClusters * numDimensions) + dimension);
-            }
-            sumOfClusterSizes += clusterSize;
-            ++numProcessedClusters;
-        }
+    std::vector<cde::RankSumResult> rankSumResults(numDimensions);
+    std::vector<std::ptrdiff_t> dimensions[2];
+    std::vector<float> columns[2];
 
-        std::size_t progressOffset = (selected_clusters.size() * numDimensions);
+    _progressManager.start(numBlocks, "Computing Wilcoxon Rank-Sum Tests ");
+    for (std::size_t block = 0; (block < numBlocks) && !job.cancelled; ++block)
+    {
+        const std::ptrdiff_t firstDimension = block * blockSize;
+        const std::ptrdiff_t width = std::min<std::ptrdiff_t>(blockSize, numDimensions - firstDimension);
+        for (int group = 0; group < 2; ++group)
+        {
+            dimensions[group].resize(width);
+            for (std::ptrdiff_t c = 0; c < width; ++c)
+                dimensions[group][c] = result.dimensionMatching->identical ? (firstDimension + c) : result.dimensionMatching->index(firstDimension + c, job.testDatasets[group]);
+            local::gatherColumnBlock(*job.inputs[job.testDatasets[group]].points, rows[group], dimensions[group], columns[group]);
+        }
 
-#pragma omp parallel for schedule(dynamic,1)
-        for (std::ptrdiff_t dimension = 0; dimension < numDimensions; ++dimension)
+        // every dimension is ranked on its own, so the dimensions of a block are ranked in parallel
+        const std::size_t count1 = rows[0].size();
+        const std::size_t count2 = rows[1].size();
+        #pragma omp parallel for schedule(dynamic, 1)
+        for (std::ptrdiff_t c = 0; c < width; ++c)
         {
-            meanExpressions_cluster1[dimension] /= sumOfClusterSizes;
-  //          _progressManager.print(progressOffset + dimension);
+            if (dimensions[0][c] < 0 || dimensions[1][c] < 0)
+                rankSumResults[firstDimension + c] = { std::numeric_limits<double>::quiet_NaN(), std::numeric_limits<double>::quiet_NaN(), std::numeric_limits<double>::quiet_NaN() };
+            else
+                rankSumResults[firstDimension + c] = cde::rankSumTest(columns[0].data() + (c * count1), count1, columns[1].data() + (c * count2), count2);
         }
-        progressOffset += numDimensions;
+        _progressManager.print(block);
     }
+    _progressManager.end();
 
-   // _progressManager.end();
-    return meanExpressions_cluster1;
+    return rankSumResults;
+}
+
+void ClusterDifferentialExpressionPlugin::scheduleAutoUpdate()
+{
+    // the running computation is stale already, it is cancelled now instead of being rerun after it finished
+    cancelComputeDE(false);
+
+    // every change restarts the wait, so a burst of changes is computed once, with the selection of its last change
+    _autoUpdateTimer.start(_autoUpdateDelayAction.getValue());
 }
 
 void ClusterDifferentialExpressionPlugin::computeDE()
 {
+    _autoUpdateTimer.stop();
+
     if (_tableItemModel->status() == QTableItemModel::Status::UpToDate)
     {
       //  qDebug() << "ClusterDifferentialExpressionPlugin::computeDE model up-to-date";
         return;
     }
+
+    // the inputs of a running computation are out of date by now: cancel it and start over once it has stopped
+    if (_computeDEWatcher.isRunning())
+    {
+        cancelComputeDE(true);
+        return;
+    }
+
+    // the table of this computation replaces the one a running batch job would publish
+    if (_batchJob && _batchJob->replacesTable)
+    {
+        _pendingBatchRequest = nullptr;
+        cancelBatchJob();
+    }
+
+    // the statistics being updated are read once they are complete
+    if (_statisticsUpdateWatcher.isRunning())
+    {
+        _computeDERerun = true;
+        return;
+    }
+
     _tableItemModel->setStatus(QTableItemModel::Status::Updating);
     const qsizetype NrOfDatasets = _loadedDatasetsAction.size();
     assert(NrOfDatasets >= 2);
 
-    qsizetype NrOfSelectedDatasets = 0;
     for(qsizetype i=0; i < NrOfDatasets; ++i)
     {
         if (_loadedDatasetsAction.data(i)->datasetSelectedAction.isChecked())
         {
-            NrOfSelectedDatasets++;
             if (_loadedDatasetsAction.getClusterSelection(i).size() == 0)
                 return;
         }
     }
 
-    enum { ID, MEAN_DE };
-    auto preInfoMap = _preInfoVariantAction.getVariant().toMap();
-    auto postInfoMap = _postInfoVariantAction.getVariant().toMap();
-    qsizetype columnOffset = preInfoMap.size();
-    std::size_t totalColumnCount = columnOffset + 2 + NrOfSelectedDatasets + postInfoMap.size();
-    if (NrOfSelectedDatasets > 2)
-        totalColumnCount += 2; // for min and max DE
+    _computeDEJob = prepareDEJob();
+    if (!_computeDEJob)
+    {
+        _tableItemModel->invalidate();
+        return;
+    }
+
+    // the table of a recent selection is swapped back into the model instead of being computed again
+    const std::vector<std::shared_ptr<const void>> sources = resultSources(*_computeDEJob);
+    if (!sources.empty())
+    {
+        if (_displayedResult.matches(_computeDEJob->resultKey, sources))
+        {
+            _computeDEJob.reset();
+            _tableItemModel->setStatus(QTableItemModel::Status::UpToDate);
+            return;
+        }
+
+        cde::ResultTable table;
+        if (_resultHistory.take(_computeDEJob->resultKey, sources, table))
+        {
+            std::unique_ptr<DEJob> job = std::move(_computeDEJob);
+            DEResult result;
+            result.dimensionMatching = std::move(table.dimensionMatching);
+            result.rowDimensions = std::move(table.rowDimensions);
+            result.totalColumnCount = table.columns.size();
+            result.columns = std::move(table.columns);
+            commitDEResult(*job, result);
+            return;
+        }
+    }
+
+    DEJob* job = _computeDEJob.get();
+    _computeDEWatcher.setFuture(QtConcurrent::run([this, job]() { return computeDEResult(*job); }));
+}
+
+std::unique_ptr<ClusterDifferentialExpressionPlugin::DEJob> ClusterDifferentialExpressionPlugin::prepareDEJob()
+{
+    auto job = std::make_unique<DEJob>();
+
+    const qsizetype NrOfDatasets = _loadedDatasetsAction.size();
+    job->inputs.resize(NrOfDatasets);
+    job->dimensionNames.resize(NrOfDatasets);
+
+    for (qsizetype i = 0; i < NrOfDatasets; ++i)
+    {
+        DEJob::Input& input = job->inputs[i];
+        input.clusterDataset = getDataset(i);
+        if (!input.clusterDataset.isValid())
+            continue;
+
+        mv::Dataset<Points> points = local::findParentPoints(input.clusterDataset);
+        if (points.isValid())
+        {
+            input.points = points.get();
+            input.pointsId = points->getId();
+            input.name = QString("%1 - %2").arg(points->getGuiName(), input.clusterDataset->getGuiName());
+            job->dimensionNames[i] = points->getDimensionNames();
+        }
+
+        input.selected = _loadedDatasetsAction.data(i)->datasetSelectedAction.isChecked();
+        if (!input.selected)
+            continue;
+
+        // the per-cluster statistics and the raw values both come from the parent points
+        if (input.points == nullptr)
+            return nullptr;
+
+        ++job->numSelectedDatasets;
+        input.clusters = input.clusterDataset->getClusters();
+
+        const QSet<unsigned> selectedClusters = local::getClusterIndices(_loadedDatasetsAction.getClusterOptions(i), _loadedDatasetsAction.getClusterSelection(i));
+        input.selectedClusters.assign(selectedClusters.cbegin(), selectedClusters.cend());
+        std::sort(input.selectedClusters.begin(), input.selectedClusters.end());
+
+        // DE_Statistics stored without their sibling datasets are recomputed by the worker; it reads copies, as the datasets may change meanwhile
+        auto statisticsDatasets = find_DE_Statistics(input.clusterDataset);
+        input.hasStatistics = statisticsDatasets && statisticsDatasets->hasSiblings() && local::readClusterTables(*statisticsDatasets, input.clusters, input.statistics, true);
+        if (input.hasStatistics)
+        {
+            input.statisticsDatasets = statisticsDatasets;
+            input.groupStatistics = _groupStatisticsCache.find(input.clusterDataset->getId(), input.selectedClusters, statisticsDatasets);
+        }
+    }
+
+    // the statistical tests compare exactly two groups, i.e. the two selected datasets
+    if (job->numSelectedDatasets == 2)
+    {
+        for (qsizetype i = 0, j = 0; (i < NrOfDatasets) && (j < 2); ++i)
+        {
+            if (job->inputs[i].selected)
+                job->testDatasets[j++] = i;
+        }
+        job->welchTest = _welchTestAction.isChecked();
+        job->rankSumTest = _rankSumTestAction.isChecked();
+    }
+
+    job->preInfoMap = _preInfoVariantAction.getVariant().toMap();
+    job->postInfoMap = _postInfoVariantAction.getVariant().toMap();
 
 #ifdef _DEBUG
-    qDebug() << "computeDE: _preinfoVariantAction map size= " << preInfoMap.size();
-    for(auto it = preInfoMap.cbegin(); it != preInfoMap.cend(); ++it)
+    qDebug() << "computeDE: _preinfoVariantAction map size= " << job->preInfoMap.size();
+    for(auto it = job->preInfoMap.cbegin(); it != job->preInfoMap.cend(); ++it)
     {
         qDebug() << it.key() << " " << it->toMap().size();
     }
@@ -1593,103 +2582,172 @@ void ClusterDifferentialExpressionPlugin::computeDE()
         _postInfoVariantAction.setVariant(emptColumn);
     }
     */
-    
 
-    std::vector<std::vector<double>> meanExpressionValues(NrOfDatasets);
-	//#pragma omp parallel for schedule(dynamic,1)
+    job->dimensionMatching = _dimensionMatchingCache.find(job->dimensionNames);
+
+    job->tileSize = _statisticsTileSizeAction.getValue();
+    job->streamingChunkRows = _streamingChunkRowsAction.getValue();
+    job->topK = _showAllRowsAction.isChecked() ? 0 : _topKRowsAction.getValue();
+
+    job->rankBlockSize = _rankTestBlockSizeAction.getValue();
+    job->sparseDensityThreshold = _sparseDensityThresholdAction.getValue();
+
+    QStringList datasetIds;
+    std::vector<char> selected(NrOfDatasets);
+    std::vector<std::vector<unsigned>> selectedClusters(NrOfDatasets);
     for (qsizetype i = 0; i < NrOfDatasets; ++i)
     {
-        if(_loadedDatasetsAction.data(i)->datasetSelectedAction.isChecked())
-        {
-            QStringList clusterStrings = _loadedDatasetsAction.getClusterOptions(i);
-            QStringList clusterSelectionStrings = _loadedDatasetsAction.getClusterSelection(i);
-            meanExpressionValues[i] = computeMeanExpressionsForSelectedClusters(getDataset(i), local::getClusterIndices(clusterStrings, clusterSelectionStrings));
+        const DEJob::Input& input = job->inputs[i];
+        datasetIds << (input.clusterDataset.isValid() ? input.clusterDataset->getId() + "/" + input.pointsId : QString());
+        selected[i] = input.selected;
+        selectedClusters[i] = input.selectedClusters;
+    }
+    job->resultKey = local::resultKey(datasetIds, selected, selectedClusters, job->welchTest, job->rankSumTest, job->topK, _preInfoVersion, _postInfoVersion);
 
-            auto DE_StatisticsDataset = get_DE_Statistics_Dataset(_loadedDatasetsAction.getDataset(i));
-            if (DE_StatisticsDataset.isValid())
-                _DE_StatisticsDatasetGuidAction[i].data()->setString(DE_StatisticsDataset.getDatasetId());
-        }
+    return job;
+}
+
+std::shared_ptr<ClusterDifferentialExpressionPlugin::DEResult> ClusterDifferentialExpressionPlugin::computeDEResult(DEJob& job)
+{
+    auto result = std::make_shared<DEResult>();
+
+    const qsizetype NrOfDatasets = job.inputs.size();
+    const qsizetype NrOfSelectedDatasets = job.numSelectedDatasets;
+    result->statistics.resize(NrOfDatasets);
+    result->computedStatistics.assign(NrOfDatasets, false);
+
+    // the stages are weighted by their number of value visits, a table row costs about as much as a few dozen of those
+    constexpr double ROW_WEIGHT = 64;
+    const double numJobDimensions = static_cast<double>(job.dimensionNames.empty() ? 0 : job.dimensionNames[0].size());
+    std::vector<ProgressManager::Stage> stages;
+    std::vector<std::size_t> statisticsStages(NrOfDatasets, 0);
+    for (qsizetype i = 0; i < NrOfDatasets; ++i)
+    {
+        const DEJob::Input& input = job.inputs[i];
+        if (!input.selected || input.hasStatistics)
+            continue;
+        statisticsStages[i] = stages.size();
+        stages.push_back({ QString("Computing DE Statistics for %1").arg(input.name), static_cast<double>(input.points->getNumPoints()) * input.points->getNumDimensions() });
+    }
+    const std::size_t matchingStage = stages.size();
+    stages.push_back({ "Matching Dimensions", job.dimensionMatching ? 0.0 : numJobDimensions * NrOfDatasets });
+    const std::size_t rankSumStage = stages.size();
+    double rankSumWeight = 0;
+    if (job.rankSumTest)
+    {
+        for (qsizetype testDataset : job.testDatasets)
+            rankSumWeight += static_cast<double>(job.inputs[testDataset].points->getNumPoints()) * numJobDimensions;
     }
-    
-   
+    stages.push_back({ "Computing Wilcoxon Rank-Sum Tests", rankSumWeight });
+    const std::size_t rowsStage = stages.size();
+    stages.push_back({ "Computing Differential Expresions", ROW_WEIGHT * numJobDimensions * NrOfSelectedDatasets });
 
- 
-    if(!_identicalDimensions)
-        if (_matchingDimensionNames.empty())
-        {
-            _identicalDimensions = matchDimensionNames();
-        	assert(_identicalDimensions || (!_matchingDimensionNames.empty()));
-        }
+    ProgressTask progressTask(_progressManager, "Computing Differential Expresions", std::move(stages), &job.cancelled);
 
-    std::vector<QString> unifiedDimensionNames;
+    // per-cluster statistics of the datasets that do not have their DE_Statistics yet
     for (qsizetype i = 0; i < NrOfDatasets; ++i)
     {
-        if (_loadedDatasetsAction.data(i)->datasetSelectedAction.isChecked())
+        DEJob::Input& input = job.inputs[i];
+        if (!input.selected || input.hasStatistics)
+            continue;
+
+        progressTask.beginStage(statisticsStages[i]);
+        const std::string message = QString("Computing DE Statistics for %1").arg(input.name).toStdString();
+        if (!local::computeCachedClusterStatistics(*input.points, input.clusters, job.dimensionNames[i], job.sparseDensityThreshold, job.tileSize, job.streamingChunkRows, message, _progressManager, &job.cancelled, _statisticsDiskCache, result->statistics[i]))
         {
-            unifiedDimensionNames = get_DE_Statistics_Dataset(getDataset(0))->getDimensionNames();
-            break;
+            result->cancelled = true;
+            return result;
         }
+        result->computedStatistics[i] = true;
+        local::setClusterTables(result->statistics[i], input.statistics);
+        input.hasStatistics = true;
     }
-    std::ptrdiff_t numDimensions =(std::ptrdiff_t) (_identicalDimensions ? unifiedDimensionNames.size() : _matchingDimensionNames.size());
-	QStringList dimensionNames; 
-    for (auto dimension : unifiedDimensionNames)
+
+    std::vector<std::shared_ptr<const cde::GroupStatistics>>& groupStatistics = result->groupStatistics;
+    groupStatistics.resize(NrOfDatasets);
+    for (qsizetype i = 0; i < NrOfDatasets; ++i)
     {
-        dimensionNames << dimension;
+        if (!job.inputs[i].selected)
+            continue;
+        groupStatistics[i] = job.inputs[i].groupStatistics;
+        if (!groupStatistics[i])
+            groupStatistics[i] = std::make_shared<const cde::GroupStatistics>(cde::poolClusters(job.inputs[i].statistics.tables, job.inputs[i].selectedClusters));
     }
-	_selectedDimensionAction.setOptions(dimensionNames);
-
-    _tableItemModel->startModelBuilding(totalColumnCount, numDimensions);
-    _progressManager.start(numDimensions, "Computing Differential Expresions ");
 
-   
-	#pragma omp  parallel for schedule(dynamic,1)
-    for (std::ptrdiff_t dimension = 0; dimension < numDimensions; ++dimension)
+    result->dimensionMatching = job.dimensionMatching;
+    if (!result->dimensionMatching)
     {
-        std::vector<QVariant> dataVector(totalColumnCount);
-        QString dimensionName = _identicalDimensions ?  unifiedDimensionNames[dimension] : _matchingDimensionNames[dimension].first;
+        progressTask.beginStage(matchingStage);
+        result->dimensionMatching = std::make_shared<const cde::DimensionMatching>(cde::matchDimensionNames(job.dimensionNames));
+        result->matchedDimensions = true;
+    }
+    const cde::DimensionMatching& matching = *result->dimensionMatching;
 
-        std::vector<double> mean(NrOfDatasets);
-        if(_identicalDimensions)
+    const std::vector<QString>& unifiedDimensionNames = job.dimensionNames[0];
+    std::ptrdiff_t numDimensions =(std::ptrdiff_t) (matching.identical ? unifiedDimensionNames.size() : matching.size());
+
+    const bool computeWelchTest = job.welchTest;
+    const bool computeRankSumTest = job.rankSumTest;
+    const qsizetype* testDatasets = job.testDatasets;
+
+    std::vector<cde::RankSumResult> rankSumResults;
+    if (computeRankSumTest)
+    {
+        progressTask.beginStage(rankSumStage);
+        rankSumResults = computeRankSumTests(job, *result, numDimensions);
+        if (job.cancelled)
         {
-            for(qsizetype datasetIndex =0; datasetIndex < NrOfDatasets; ++datasetIndex)
-            {
-                if (_loadedDatasetsAction.data(datasetIndex)->datasetSelectedAction.isChecked())
-                {
-                    mean[datasetIndex] = meanExpressionValues[datasetIndex][dimension];
-                }
-            }
+            result->cancelled = true;
+            return result;
         }
-        else
+    }
+
+    enum { ID, MEAN_DE };
+    const QVariantMap& preInfoMap = job.preInfoMap;
+    const QVariantMap& postInfoMap = job.postInfoMap;
+    qsizetype columnOffset = preInfoMap.size();
+    std::size_t totalColumnCount = columnOffset + 2 + NrOfSelectedDatasets + postInfoMap.size();
+    if (NrOfSelectedDatasets > 2)
+        totalColumnCount += 2; // for min and max DE
+    if (computeWelchTest)
+        totalColumnCount += 3; // for t-statistic, p-value and adjusted p-value
+    if (computeRankSumTest)
+        totalColumnCount += 3; // for U, AUROC and p-value
+    result->totalColumnCount = totalColumnCount;
+    // mean of every selected dataset for a matched dimension, NaN for the datasets that lack the dimension
+    const auto datasetMeans = [&job, &groupStatistics, &matching, NrOfDatasets](std::ptrdiff_t dimension, std::vector<double>& mean)
+    {
+        for (qsizetype datasetIndex = 0; datasetIndex < NrOfDatasets; ++datasetIndex)
         {
-            for (qsizetype datasetIndex = 0; datasetIndex < NrOfDatasets; ++datasetIndex)
-            {
-                if(_loadedDatasetsAction.data(datasetIndex)->datasetSelectedAction.isChecked())
-                {
-                    qsizetype dimensionIndex = _matchingDimensionNames[dimension].second[datasetIndex];
-                    if (dimensionIndex >= 0)
-                        mean[datasetIndex] = meanExpressionValues[datasetIndex][dimensionIndex];
-                    else
-                        mean[datasetIndex] = std::numeric_limits<double>::quiet_NaN();
-                }
-            }
+            if (!job.inputs[datasetIndex].selected)
+                continue;
+            const qsizetype dimensionIndex = matching.identical ? dimension : matching.index(dimension, datasetIndex);
+            if (dimensionIndex >= 0)
+                mean[datasetIndex] = groupStatistics[datasetIndex]->mean[dimensionIndex];
+            else
+                mean[datasetIndex] = std::numeric_limits<double>::quiet_NaN();
         }
+    };
 
+    // the signed difference of the two selected datasets, or the mean, min and max absolute difference of all pairs of more datasets
+    const auto differentialExpression = [&job, NrOfDatasets, NrOfSelectedDatasets, testDatasets](const std::vector<double>& mean, double& min_DE, double& max_DE)
+    {
         double mean_DE = 0;
-        double min_DE = std::numeric_limits<double >::max();
-        double max_DE = std::numeric_limits<double>::lowest();
+        min_DE = std::numeric_limits<double >::max();
+        max_DE = std::numeric_limits<double>::lowest();
         if(NrOfSelectedDatasets > 2)
         {
             std::size_t counter = 0;
             for (qsizetype datasetIndex1 = 0; datasetIndex1 < NrOfDatasets; ++datasetIndex1)
             {
-                if (_loadedDatasetsAction.data(datasetIndex1)->datasetSelectedAction.isChecked())
+                if (job.inputs[datasetIndex1].selected)
                 {
                     double mean1 = mean[datasetIndex1];
                     if (!std::isnan(mean1))
                     {
                         for (qsizetype datasetIndex2 = (datasetIndex1 + 1); datasetIndex2 < NrOfDatasets; ++datasetIndex2)
                         {
-                            if (_loadedDatasetsAction.data(datasetIndex2)->datasetSelectedAction.isChecked())
+                            if (job.inputs[datasetIndex2].selected)
                             {
                                 const double diffExp = fabs(mean1 - mean[datasetIndex2]);
                                 if (diffExp > max_DE)
@@ -1707,12 +2765,93 @@ void ClusterDifferentialExpressionPlugin::computeDE()
         }
         else
         {
+            // the selected datasets are not necessarily the first two, the unselected ones have no mean
             if(NrOfSelectedDatasets ==2)
-				mean_DE = mean[0] - mean[1]; // no fabs since we want to preserve the sign
+				mean_DE = mean[testDatasets[0]] - mean[testDatasets[1]]; // no fabs since we want to preserve the sign
         }
-        
+        return mean_DE;
+    };
+
+    const auto welchTest = [&groupStatistics, &matching, testDatasets](std::ptrdiff_t dimension)
+    {
+        cde::WelchTestResult welch = { std::numeric_limits<double>::quiet_NaN(), std::numeric_limits<double>::quiet_NaN(), std::numeric_limits<double>::quiet_NaN() };
+        qsizetype dimensionIndex[2] = { dimension, dimension };
+        if (!matching.identical)
+        {
+            dimensionIndex[0] = matching.index(dimension, testDatasets[0]);
+            dimensionIndex[1] = matching.index(dimension, testDatasets[1]);
+        }
+        if ((dimensionIndex[0] >= 0) && (dimensionIndex[1] >= 0))
+        {
+            const cde::GroupStatistics& group1 = *groupStatistics[testDatasets[0]];
+            const cde::GroupStatistics& group2 = *groupStatistics[testDatasets[1]];
+            welch = cde::welchTTest(group1.mean[dimensionIndex[0]], group1.variance[dimensionIndex[0]], group1.count,
+                                    group2.mean[dimensionIndex[1]], group2.variance[dimensionIndex[1]], group2.count);
+        }
+        return welch;
+    };
+
+    std::vector<double> pValues(computeWelchTest ? numDimensions : 0);
+    const std::size_t adjustedPValueColumn = columnOffset + 4; // after ID, DE, t-statistic and p-value
+
+    // in top K mode only the rows of the K dimensions with the largest absolute differential expression are built,
+    // the scores of all dimensions are computed into a plain array first
+    std::ptrdiff_t numRows = numDimensions;
+    if ((job.topK > 0) && (job.topK < static_cast<std::size_t>(numDimensions)))
+    {
+        std::vector<float> scores(numDimensions);
+        #pragma omp parallel
+        {
+            std::vector<double> mean(NrOfDatasets);
+            double min_DE, max_DE;
+            #pragma omp for schedule(static)
+            for (std::ptrdiff_t dimension = 0; dimension < numDimensions; ++dimension)
+            {
+                datasetMeans(dimension, mean);
+                const double score = std::fabs(differentialExpression(mean, min_DE, max_DE));
+                scores[dimension] = std::isnan(score) ? -1.0f : static_cast<float>(score);
+                // the adjusted p-values are computed over all dimensions, not just the ones shown
+                if (computeWelchTest)
+                    pValues[dimension] = welchTest(dimension).pValue;
+            }
+        }
+
+        numRows = static_cast<std::ptrdiff_t>(job.topK);
+        result->rowDimensions.resize(numDimensions);
+        std::iota(result->rowDimensions.begin(), result->rowDimensions.end(), 0);
+        const auto higherScore = [&scores](qsizetype a, qsizetype b) { return (scores[a] > scores[b]) || ((scores[a] == scores[b]) && (a < b)); };
+#if defined(__cpp_lib_parallel_algorithm)
+        std::nth_element(std::execution::par_unseq, result->rowDimensions.begin(), result->rowDimensions.begin() + (numRows - 1), result->rowDimensions.end(), higherScore);
+        std::sort(std::execution::par_unseq, result->rowDimensions.begin(), result->rowDimensions.begin() + numRows, higherScore);
+#else
+        std::nth_element(result->rowDimensions.begin(), result->rowDimensions.begin() + (numRows - 1), result->rowDimensions.end(), higherScore);
+        std::sort(result->rowDimensions.begin(), result->rowDimensions.begin() + numRows, higherScore);
+#endif
+        result->rowDimensions.resize(numRows);
+    }
+    result->rows.resize(numRows);
+
+    progressTask.beginStage(rowsStage);
+    _progressManager.start(numRows, "Computing Differential Expresions ");
+
+    // every thread fills its own contiguous batch of rows, the rows are moved into the model in one go by commitDEResult
+    constexpr int ROW_BATCH_SIZE = 64;
+	#pragma omp  parallel for schedule(dynamic, ROW_BATCH_SIZE)
+    for (std::ptrdiff_t row = 0; row < numRows; ++row)
+    {
+        // an OpenMP loop cannot be left early, the remaining iterations are skipped instead
+        if (job.cancelled.load(std::memory_order_relaxed))
+            continue;
+
+        const std::ptrdiff_t dimension = result->rowDimensions.empty() ? row : result->rowDimensions[row];
+        std::vector<QVariant> dataVector(totalColumnCount);
+        QString dimensionName = matching.identical ?  unifiedDimensionNames[dimension] : matching.names[dimension];
+
+        std::vector<double> mean(NrOfDatasets);
+        datasetMeans(dimension, mean);
+        double min_DE, max_DE;
+        const double mean_DE = differentialExpression(mean, min_DE, max_DE);
 
-     
         dataVector[ID] = dimensionName;
         std::size_t columnNr = 1;
         for (auto info = preInfoMap.cbegin(); info != preInfoMap.cend(); ++info, ++columnNr)
@@ -1731,10 +2870,36 @@ void ClusterDifferentialExpressionPlugin::computeDE()
             dataVector[columnNr++] = local::fround(min_DE, 3);
             dataVector[columnNr++] = local::fround(max_DE, 3);
         }
+
+        if (computeWelchTest)
+        {
+            const cde::WelchTestResult welch = welchTest(dimension);
+            pValues[dimension] = welch.pValue;
+
+            dataVector[columnNr++] = local::roundedCell(welch.t);
+            dataVector[columnNr++] = local::pValueCell(welch.pValue);
+            ++columnNr; // adjusted p-value, filled in once all p-values are known
+        }
+
+        if (computeRankSumTest)
+        {
+            const cde::RankSumResult& rankSum = rankSumResults[dimension];
+            if (std::isnan(rankSum.U))
+            {
+                dataVector[columnNr++] = "N/A";
+                dataVector[columnNr++] = "N/A";
+            }
+            else
+            {
+                dataVector[columnNr++] = rankSum.U;
+                dataVector[columnNr++] = local::fround(rankSum.auroc, 3);
+            }
+            dataVector[columnNr++] = local::pValueCell(rankSum.pValue);
+        }
        
         for (qsizetype datasetIndex = 0; datasetIndex < NrOfDatasets; ++datasetIndex)
         {
-            if(_loadedDatasetsAction.data(datasetIndex)->datasetSelectedAction.isChecked())
+            if(job.inputs[datasetIndex].selected)
             {
                 double meanValue = mean[datasetIndex];
                 if (std::isnan(meanValue))
@@ -1759,14 +2924,140 @@ void ClusterDifferentialExpressionPlugin::computeDE()
             }
         }
 
-        
+        result->rows[row] = std::move(dataVector);
+        _progressManager.print(row);
+    }
+    _progressManager.end();
 
-        _tableItemModel->setRow(dimension, dataVector, Qt::Unchecked, true);
-        _progressManager.print(dimension);
+    if (job.cancelled)
+    {
+        result->cancelled = true;
+        return result;
     }
-   
 
-   
+    if (computeWelchTest)
+    {
+        const std::vector<double> adjustedPValues = cde::benjaminiHochberg(pValues);
+        for (std::ptrdiff_t row = 0; row < numRows; ++row)
+        {
+            const std::ptrdiff_t dimension = result->rowDimensions.empty() ? row : result->rowDimensions[row];
+            result->rows[row][adjustedPValueColumn] = local::pValueCell(adjustedPValues[dimension]);
+        }
+    }
+
+    return result;
+}
+
+void ClusterDifferentialExpressionPlugin::cancelComputeDE(bool rerun)
+{
+    if (!_computeDEWatcher.isRunning() || !_computeDEJob)
+        return;
+
+    _computeDERerun = rerun;
+    _computeDEJob->cancelled = true;
+
+    // only shows "Canceling..." until computeDEFinished, the flag itself stops no computation
+    _progressManager.setCanceled(true);
+}
+
+void ClusterDifferentialExpressionPlugin::computeDEFinished()
+{
+    _progressManager.setCanceled(false);
+
+    std::unique_ptr<DEJob> job = std::move(_computeDEJob);
+    std::shared_ptr<DEResult> result = _computeDEWatcher.result();
+    if (!job || !result)
+        return;
+
+    // completely computed per-cluster statistics stay valid, even when the table itself is no longer wanted, unless their points changed
+    for (std::size_t i = 0; (i < job->inputs.size()) && !job->inputsChanged; ++i)
+    {
+        if (result->computedStatistics[i] && job->inputs[i].clusterDataset.isValid())
+        {
+            local::storeClusterStatistics(job->inputs[i].clusterDataset, job->dimensionNames[i], result->statistics[i]);
+            _DE_StatisticsDatasets.remove(job->inputs[i].clusterDataset->getId());
+            trackClusterStatistics(job->inputs[i].clusterDataset, std::move(result->statistics[i]), cde::clusterMembers(job->inputs[i].clusters));
+        }
+
+        // the pooled statistics are versioned by the DE_Statistics they were pooled from, the ones just stored for computed statistics
+        if ((i < result->groupStatistics.size()) && result->groupStatistics[i] && job->inputs[i].clusterDataset.isValid())
+        {
+            std::shared_ptr<const DE_StatisticsDatasets> source = result->computedStatistics[i] ? find_DE_Statistics(job->inputs[i].clusterDataset) : job->inputs[i].statisticsDatasets;
+            _groupStatisticsCache.insert(job->inputs[i].clusterDataset->getId(), job->inputs[i].selectedClusters, source, result->groupStatistics[i]);
+        }
+    }
+
+    if (result->matchedDimensions)
+        _dimensionMatchingCache.insert(job->dimensionNames, result->dimensionMatching);
+
+    // the cluster changes that arrived while the worker was reading the tables
+    processPendingStatisticsUpdates();
+
+    // the marker table replaces whatever the worker produced
+    if (_computeMarkersPending)
+    {
+        _computeMarkersPending = false;
+        _computeDERerun = false;
+        _tableItemModel->invalidate();
+        computeMarkers();
+        return;
+    }
+
+    // the model is invalidated while the worker runs when its inputs change
+    const bool rerun = _computeDERerun;
+    _computeDERerun = false;
+    if (result->cancelled || rerun || (_tableItemModel->status() != QTableItemModel::Status::Updating))
+    {
+        _tableItemModel->invalidate();
+        if (rerun)
+            computeDE();
+        return;
+    }
+
+    commitDEResult(*job, *result);
+}
+
+void ClusterDifferentialExpressionPlugin::commitDEResult(DEJob& job, DEResult& result)
+{
+    const qsizetype NrOfDatasets = job.inputs.size();
+    const qsizetype NrOfSelectedDatasets = job.numSelectedDatasets;
+    const bool computeWelchTest = job.welchTest;
+    const bool computeRankSumTest = job.rankSumTest;
+    const QVariantMap& preInfoMap = job.preInfoMap;
+    const QVariantMap& postInfoMap = job.postInfoMap;
+
+    for (qsizetype i = 0; i < NrOfDatasets; ++i)
+    {
+        if (job.inputs[i].selected)
+        {
+            auto statisticsDatasets = find_DE_Statistics(job.inputs[i].clusterDataset);
+            if (statisticsDatasets)
+                _DE_StatisticsDatasetGuidAction[i].data()->setString(statisticsDatasets->means.getDatasetId());
+        }
+    }
+
+    _dimensionMatching = result.dimensionMatching;
+
+	QStringList dimensionNames; 
+    for (auto dimension : job.dimensionNames[0])
+    {
+        dimensionNames << dimension;
+    }
+	_selectedDimensionAction.setOptions(dimensionNames);
+
+    // a table from the result history only exchanges its columns with the ones of the table shown now
+    const bool restored = !result.columns.empty();
+    const std::ptrdiff_t numDimensions = restored ? result.columns.front().size() : result.rows.size();
+    std::vector<QTableItemModel::Column> previousColumns;
+    _tableItemModel->startModelBuilding(result.totalColumnCount, numDimensions, &previousColumns);
+    stashDisplayedResult(std::move(previousColumns));
+    _tableRowDimensions = std::move(result.rowDimensions);
+    if (restored)
+        _tableItemModel->swapColumns(result.columns, Qt::Unchecked);
+    else
+        _tableItemModel->setRows(std::move(result.rows), Qt::Unchecked);
+
+    enum { ID, MEAN_DE };
     QString emptyString;
     
     _tableItemModel->setHorizontalHeader(ID, QString("ID"));
@@ -1788,12 +3079,24 @@ void ClusterDifferentialExpressionPlugin::computeDE()
     {
         _tableItemModel->setHorizontalHeader(columnNr++, "Differential Expression");
     }
+    if (computeWelchTest)
+    {
+        _tableItemModel->setHorizontalHeader(columnNr++, "T-Statistic");
+        _tableItemModel->setHorizontalHeader(columnNr++, "P-Value");
+        _tableItemModel->setHorizontalHeader(columnNr++, "Adjusted P-Value (BH)");
+    }
+    if (computeRankSumTest)
+    {
+        _tableItemModel->setHorizontalHeader(columnNr++, "U");
+        _tableItemModel->setHorizontalHeader(columnNr++, "AUROC");
+        _tableItemModel->setHorizontalHeader(columnNr++, "Rank-Sum P-Value");
+    }
    
     
     for (qsizetype datasetIndex = 0; datasetIndex < NrOfDatasets; ++datasetIndex)
     {
 
-        if (_loadedDatasetsAction.data(datasetIndex)->datasetSelectedAction.isChecked())
+        if (job.inputs[datasetIndex].selected)
         {
             //_datasetTableViewHeader[datasetIndex]->setParent(_differentialExpressionWidget->getTableView()->horizontalHeader());
             //_datasetTableViewHeader[datasetIndex]->raise();
@@ -1829,7 +3132,252 @@ void ClusterDifferentialExpressionPlugin::computeDE()
     }
 
     _tableItemModel->endModelBuilding();
-    _progressManager.end();
+
+    // the table is versioned by the DE_Statistics as they are after the computed ones were stored
+    _displayedResult.key = job.resultKey;
+    _displayedResult.dimensionMatching = _dimensionMatching;
+    for (qsizetype i = 0; i < NrOfDatasets; ++i)
+    {
+        if (!job.inputs[i].selected)
+            continue;
+        auto statisticsDatasets = find_DE_Statistics(job.inputs[i].clusterDataset);
+        if (!statisticsDatasets)
+        {
+            _displayedResult.key.clear();
+            break;
+        }
+        _displayedResult.sources.push_back(statisticsDatasets);
+    }
+    updateResultHistoryUsage();
+}
+
+std::vector<std::shared_ptr<const void>> ClusterDifferentialExpressionPlugin::resultSources(const DEJob& job) const
+{
+    std::vector<std::shared_ptr<const void>> sources;
+    for (const DEJob::Input& input : job.inputs)
+    {
+        if (!input.selected)
+            continue;
+        if (!input.statisticsDatasets)
+            return {};
+        sources.push_back(input.statisticsDatasets);
+    }
+    return sources;
+}
+
+void ClusterDifferentialExpressionPlugin::stashDisplayedResult(std::vector<QTableItemModel::Column>&& columns)
+{
+    if (!_displayedResult.key.isEmpty())
+    {
+        _displayedResult.columns = std::move(columns);
+        _displayedResult.rowDimensions = std::move(_tableRowDimensions);
+        _resultHistory.insert(std::move(_displayedResult));
+    }
+    _displayedResult = cde::ResultTable();
+    _tableRowDimensions.clear();
+}
+
+void ClusterDifferentialExpressionPlugin::updateResultHistoryUsage()
+{
+    const auto toMB = [](std::size_t bytes) { return QString::number(double(bytes) / (1 << 20), 'f', 1); };
+    _resultHistoryUsageAction.setString(QString("%1 tables, %2 of %3 MB").arg(_resultHistory.size()).arg(toMB(_resultHistory.memoryUsage()), toMB(_resultHistory.maximumMemory())));
+}
+
+qsizetype ClusterDifferentialExpressionPlugin::firstSelectedDatasetIndex()
+{
+    for (qsizetype i = 0; i < _loadedDatasetsAction.size(); ++i)
+    {
+        if (_loadedDatasetsAction.data(i)->datasetSelectedAction.isChecked() && getDataset(i).isValid())
+            return i;
+    }
+    return -1;
+}
+
+void ClusterDifferentialExpressionPlugin::computeMarkers()
+{
+    // the marker table replaces whatever a running computation would have produced, it is computed once that has stopped
+    if (_computeDEWatcher.isRunning())
+    {
+        _computeMarkersPending = true;
+        cancelComputeDE(false);
+        return;
+    }
+    if (deferWhileBatchJobRuns([this]() { computeMarkers(); }))
+        return;
+
+    const qsizetype datasetIndex = firstSelectedDatasetIndex();
+    if (datasetIndex < 0)
+        return;
+    mv::Dataset<Clusters> clusterDataset = getDataset(datasetIndex);
+
+    // all clusters are compared in one pass over the per-cluster tables, computed first when they are missing
+    auto statisticsDatasets = get_DE_Statistics(clusterDataset, "Markers", [this]() { computeMarkers(); });
+    const QVector<Cluster>& clusters = clusterDataset->getClusters();
+    auto table = std::make_shared<local::MarkerTable>();
+    if (!statisticsDatasets || !local::readClusterTables(*statisticsDatasets, clusters, table->stored, true))
+        return;
+
+    table->dimensionNames = statisticsDatasets->meansData->getDimensionNames();
+    for (const auto& cluster : clusters)
+        table->clusterNames.push_back(cluster.getName());
+    table->markersPerCluster = _markersPerClusterAction.getValue();
+
+    // clicking a marker selects its dimension in all loaded datasets, i.e. its dimension in the matched dimensions
+    if (!_dimensionMatching)
+        matchDimensionNames();
+    table->matchedDimensions.assign(table->dimensionNames.size(), -1);
+    if (_dimensionMatching->identical)
+    {
+        std::iota(table->matchedDimensions.begin(), table->matchedDimensions.end(), 0);
+    }
+    else
+    {
+        for (qsizetype dimension = 0; dimension < static_cast<qsizetype>(_dimensionMatching->size()); ++dimension)
+        {
+            const qsizetype datasetDimension = _dimensionMatching->index(dimension, datasetIndex);
+            if ((datasetDimension >= 0) && (datasetDimension < static_cast<qsizetype>(table->matchedDimensions.size())))
+                table->matchedDimensions[datasetDimension] = dimension;
+        }
+    }
+
+    auto job = std::make_unique<BatchJob>();
+    job->name = QString("Computing Cluster Markers for %1").arg(local::getFullGuiName(clusterDataset));
+    job->replacesTable = true;
+    job->compute = [table](const std::atomic<bool>&) { local::buildMarkerRows(*table); };
+    job->publish = [this, table]() { commitMarkerTable(std::move(table->rows), std::move(table->rowDimensions)); };
+    startBatchJob(std::move(job));
+}
+
+void ClusterDifferentialExpressionPlugin::commitMarkerTable(std::vector<std::vector<QVariant>> rows, std::vector<qsizetype> rowDimensions)
+{
+    using Column = local::MarkerTable::Column;
+
+    // the dataset header widgets of the differential expression table do not apply to the marker table
+    _tableItemModel->setHeaderStatus(QTableItemModel::Status::OutDated);
+    std::vector<QTableItemModel::Column> previousColumns;
+    _tableItemModel->startModelBuilding(Column::COLUMN_COUNT, rows.size(), &previousColumns);
+    stashDisplayedResult(std::move(previousColumns));
+    _tableRowDimensions = std::move(rowDimensions);
+    _tableItemModel->setRows(std::move(rows), Qt::Unchecked);
+    _tableItemModel->setHorizontalHeader(Column::ID, QString("ID"));
+    _tableItemModel->setHorizontalHeader(Column::CLUSTER, QString("Cluster"));
+    _tableItemModel->setHorizontalHeader(Column::RANK, QString("Rank"));
+    _tableItemModel->setHorizontalHeader(Column::MEAN_DE, QString("Differential Expression"));
+    _tableItemModel->setHorizontalHeader(Column::T_STATISTIC, QString("T-Statistic"));
+    _tableItemModel->setHorizontalHeader(Column::P_VALUE, QString("P-Value"));
+    _tableItemModel->setHorizontalHeader(Column::CLUSTER_MEAN, QString("Cluster Mean"));
+    _tableItemModel->setHorizontalHeader(Column::REST_MEAN, QString("Rest Mean"));
+    _tableItemModel->setHorizontalHeader(Column::CLUSTER_NON_ZERO_FRACTION, QString("Cluster Non-Zero Fraction"));
+    _tableItemModel->setHorizontalHeader(Column::REST_NON_ZERO_FRACTION, QString("Rest Non-Zero Fraction"));
+    _tableItemModel->endModelBuilding();
+    updateResultHistoryUsage();
+
+    // the next differential expression table brings its own header widgets again
+    _tableItemModel->setHeaderStatus(QTableItemModel::Status::OutDated);
+}
+
+bool ClusterDifferentialExpressionPlugin::deferWhileBatchJobRuns(std::function<void()> request)
+{
+    if (!_batchWatcher.isRunning())
+        return false;
+
+    // the latest request replaces the running job
+    _pendingBatchRequest = std::move(request);
+    cancelBatchJob();
+    return true;
+}
+
+void ClusterDifferentialExpressionPlugin::startBatchJob(std::unique_ptr<BatchJob> job)
+{
+    _batchJob = std::move(job);
+    BatchJob* batchJob = _batchJob.get();
+    _batchWatcher.setFuture(QtConcurrent::run([this, batchJob]()
+        {
+            ProgressTask progressTask(_progressManager, batchJob->name, { { batchJob->name, 1.0 } }, &batchJob->cancelled);
+            progressTask.beginStage(0);
+            batchJob->compute(batchJob->cancelled);
+        }));
+}
+
+void ClusterDifferentialExpressionPlugin::cancelBatchJob()
+{
+    if (!_batchWatcher.isRunning() || !_batchJob)
+        return;
+
+    _batchJob->cancelled = true;
+    _progressManager.setCanceled(true);
+}
+
+void ClusterDifferentialExpressionPlugin::batchJobFinished()
+{
+    _progressManager.setCanceled(false);
+
+    std::unique_ptr<BatchJob> job = std::move(_batchJob);
+    if (job && !job->cancelled)
+        job->publish();
+
+    if (_pendingBatchRequest)
+    {
+        std::function<void()> request = std::move(_pendingBatchRequest);
+        _pendingBatchRequest = nullptr;
+        request();
+    }
+}
+
+void ClusterDifferentialExpressionPlugin::computePairwiseDE()
+{
+    if (deferWhileBatchJobRuns([this]() { computePairwiseDE(); }))
+        return;
+
+    const qsizetype datasetIndex = firstSelectedDatasetIndex();
+    if (datasetIndex < 0)
+        return;
+    mv::Dataset<Clusters> clusterDataset = getDataset(datasetIndex);
+
+    auto statisticsDatasets = get_DE_Statistics(clusterDataset, "PairwiseDE", [this]() { computePairwiseDE(); });
+    auto tensors = std::make_shared<local::PairwiseTensors>();
+    if (!statisticsDatasets || !local::readClusterTables(*statisticsDatasets, clusterDataset->getClusters(), tensors->stored, true))
+        return;
+    tensors->k = _pairwiseTopKAction.getValue();
+
+    auto job = std::make_unique<BatchJob>();
+    job->name = QString("Computing Pairwise Differences for %1").arg(local::getFullGuiName(clusterDataset));
+    job->compute = [tensors](const std::atomic<bool>&)
+        {
+            if (tensors->k == 0)
+            {
+                tensors->values = cde::pairwiseMeanDifferences(tensors->stored.tables);
+                tensors->numDimensions = tensors->stored.tables.numDimensions;
+            }
+            else
+            {
+                cde::TopPairwiseDifferences top = cde::topPairwiseMeanDifferences(tensors->stored.tables, tensors->k);
+                tensors->values = std::move(top.values);
+                tensors->dimensions = std::move(top.dimensions);
+                tensors->numDimensions = top.k;
+            }
+        };
+    job->publish = [clusterDataset, tensors, dimensionNames = statisticsDatasets->meansData->getDimensionNames()]() mutable
+        {
+            // the cluster dataset may have been removed while the worker ran
+            if (!clusterDataset.isValid())
+                return;
+
+            // the tensors are moved into the datasets, so a heatmap reads them without another copy
+            if (tensors->k == 0)
+            {
+                local::setChildDataset(clusterDataset, local::DE_PairwiseDatasetName, std::move(tensors->values), tensors->numDimensions, dimensionNames);
+            }
+            else
+            {
+                std::vector<QString> rankNames(tensors->numDimensions);
+                for (std::size_t rank = 0; rank < tensors->numDimensions; ++rank)
+                    rankNames[rank] = QString("Top %1").arg(rank + 1);
+                local::setChildDataset(clusterDataset, local::DE_PairwiseTopKDatasetName, std::move(tensors->values), tensors->numDimensions, rankNames);
+                local::setChildDataset(clusterDataset, local::DE_PairwiseTopKDimensionsDatasetName, std::move(tensors->dimensions), tensors->numDimensions, rankNames);
+            }
+        };
+    startBatchJob(std::move(job));
 }
 
 ClusterDifferentialExpressionFactory::ClusterDifferentialExpressionFactory()
@@ -8,16 +8,28 @@
 #include <ViewPlugin.h>
 #include <Dataset.h>
 #include "widgets/DropWidget.h"
+#include "event/EventListener.h"
 #include "actions/VariantAction.h"
 #include "actions/HorizontalToolbarAction.h"
 #include "LoadedDatasetsAction.h"
+#include "ClusterStatistics.h"
+#include "DimensionMatching.h"
+#include "GroupStatisticsCache.h"
+#include "QTableItemModel.h"
+#include "ResultHistory.h"
+#include "StatisticsDiskCache.h"
+
+#include <QFutureWatcher>
+#include <QTimer>
+
+#include <functional>
+#include <memory>
 
 using mv::plugin::ViewPluginFactory;
 using mv::plugin::ViewPlugin;
 
 class TableView;
 class ButtonProgressBar;
-class QTableItemModel;
 
 
 class Points;
@@ -25,6 +37,7 @@ class Clusters;
 
 namespace cde {
 	class SortFilterProxyModel;
+	struct RankSumResult;
 }
 
 namespace mv {
@@ -33,6 +46,21 @@ namespace mv {
     }
 }
 
+/** Handles of the DE_Statistics child dataset of a cluster dataset and of its sibling statistics datasets */
+struct DE_StatisticsDatasets
+{
+    mv::Dataset<Points>     means;                  /** the DE_Statistics dataset itself */
+    mv::Dataset<Points>     variances;
+    mv::Dataset<Points>     nonZeroFractions;
+    mv::Dataset<Points>     clusterSizes;
+    Points*                 meansData = nullptr;    /** raw pointer to the means, valid as long as the handle is */
+
+    bool hasSiblings() const
+    {
+        return variances.isValid() && nonZeroFractions.isValid() && clusterSizes.isValid();
+    }
+};
+
 class ClusterDifferentialExpressionPlugin : public ViewPlugin
 {
     Q_OBJECT
@@ -42,6 +70,7 @@ class ClusterDifferentialExpressionPlugin : public ViewPlugin
 		
 public:
     ClusterDifferentialExpressionPlugin(const mv::plugin::PluginFactory* factory);
+    ~ClusterDifferentialExpressionPlugin() override;
 
     QString getOriginalName() const;
 
@@ -115,17 +144,83 @@ public slots:
     void clusterSelectionChanged(const QStringList&);
 
 private:
+    struct DEJob;
+    struct DEResult;
+    struct StatisticsUpdateJob;
+    struct BatchJob;
     
-    std::ptrdiff_t get_DE_Statistics_Index(mv::Dataset<Clusters> clusterDataset);
-    mv::Dataset<Points> get_DE_Statistics_Dataset(mv::Dataset<Clusters> clusterDataset);
-    std::vector<double> computeMeanExpressionsForSelectedClusters(mv::Dataset<Clusters> clusterDataset, const QSet<unsigned>& selected_clusters);
-    bool matchDimensionNames();
+    std::shared_ptr<const DE_StatisticsDatasets> find_DE_Statistics(mv::Dataset<Clusters> clusterDataset);
+    /**
+     * The DE_Statistics of the cluster dataset. Missing ones are computed on a worker thread: nullptr is returned then and the continuation,
+     * replacing an earlier one of the same key, is called once they are available.
+     */
+    std::shared_ptr<const DE_StatisticsDatasets> get_DE_Statistics(mv::Dataset<Clusters> clusterDataset, const QString& continuationKey, std::function<void()> continuation);
+    void requestClusterStatistics(mv::Dataset<Clusters> clusterDataset);
+    /** The DE_Statistics of the cluster dataset are being computed, or wait for a worker to do so */
+    bool computingStatistics(mv::Dataset<Clusters> clusterDataset) const;
+    void runStatisticsContinuations();
+    void trackClusterStatistics(mv::Dataset<Clusters> clusterDataset, cde::ClusterStatistics&& statistics, std::vector<cde::ClusterMember>&& members);
+    /** Applies a small change of the clusters to their statistics right away, a large one is recomputed on a worker thread */
+    void updateClusterStatistics(mv::Dataset<Clusters> clusterDataset);
+    /** Updates the statistics of the cluster datasets that changed while a worker was running */
+    void processPendingStatisticsUpdates();
+    /** Cancels the workers that read the points and waits for them, the points are about to change or go away */
+    void stopWorkersReadingPoints(const QString& pointsId, bool rerun);
+    void startStatisticsJob(mv::Dataset<Clusters> clusterDataset, mv::Dataset<Points> points, std::vector<cde::ClusterMember>&& members, bool store);
+    bool computeStatisticsUpdate(StatisticsUpdateJob& job);
+    void cancelStatisticsUpdate();
+    /** Writes the updated statistics into their DE_Statistics datasets and invalidates the table when it shows the cluster dataset */
+    void publishClusterStatistics(mv::Dataset<Clusters> clusterDataset, const DE_StatisticsDatasets& datasets, const cde::TrackedClusterStatistics& tracked);
+    void onDataEvent(mv::DatasetEvent* dataEvent);
+    /** Pooled statistics of the selected clusters, nullptr when the cluster dataset has no DE_Statistics */
+    std::shared_ptr<const cde::GroupStatistics> computeStatisticsForSelectedClusters(mv::Dataset<Clusters> clusterDataset, const QSet<unsigned>& selected_clusters);
+    std::vector<cde::RankSumResult> computeRankSumTests(const DEJob& job, const DEResult& result, std::ptrdiff_t numDimensions);
+
+    // computeDE runs in three steps: the inputs are collected on the GUI thread, the table is computed on a worker thread
+    // and the result is committed to the datasets and the table model on the GUI thread again
+    std::unique_ptr<DEJob> prepareDEJob();
+    std::shared_ptr<DEResult> computeDEResult(DEJob& job);
+    void commitDEResult(DEJob& job, DEResult& result);
+    void matchDimensionNames();
+    qsizetype firstSelectedDatasetIndex();
+
+    /** The DE_Statistics of the selected datasets of the job, empty when one of them has none */
+    std::vector<std::shared_ptr<const void>> resultSources(const DEJob& job) const;
+
+    /** Moves the table shown now, given by the columns taken out of the model, into the result history */
+    void stashDisplayedResult(std::vector<QTableItemModel::Column>&& columns);
+    void updateResultHistoryUsage();
+
+    /** Runs the job on the batch worker, publishing its result on the GUI thread once done */
+    void startBatchJob(std::unique_ptr<BatchJob> job);
+    /** When the batch worker runs, it is cancelled and the request is made again once it has stopped; returns whether it was deferred */
+    bool deferWhileBatchJobRuns(std::function<void()> request);
+    void cancelBatchJob();
+    /** Publishes the rows of the marker table, on the GUI thread */
+    void commitMarkerTable(std::vector<std::vector<QVariant>> rows, std::vector<qsizetype> rowDimensions);
+
+    /** Stops the running worker through the cancel token of its job, rerun starts computeDE again once it has stopped */
+    void cancelComputeDE(bool rerun);
+
+    /** Recomputes once the selection has not changed for the auto update delay, cancelling the computation in progress */
+    void scheduleAutoUpdate();
     //void updateData(int index);
 
+private slots:
+    void computeDEFinished();
+    void statisticsUpdateFinished();
+    void batchJobFinished();
+
 public slots:
    
     void computeDE();
 
+    /** Shows the top markers of every cluster of the first selected dataset, each cluster against all its other clusters */
+    void computeMarkers();
+
+    /** Stores the differential expression of every pair of clusters of the first selected dataset as a child dataset of its clusters */
+    void computePairwiseDE();
+
 
 
 private:
@@ -139,20 +234,39 @@ private:
     mv::gui::HorizontalToolbarAction                     _primaryToolbarAction;
    
 
-   std::vector<std::pair<QString, QVector<qsizetype>>> _matchingDimensionNames;
-
-    bool                            _identicalDimensions;
+    std::shared_ptr<const cde::DimensionMatching>   _dimensionMatching;         /** dimensions of the loaded datasets matched by name, nullptr until matched */
+    cde::DimensionMatchingCache                     _dimensionMatchingCache;
+    cde::GroupStatisticsCache                       _groupStatisticsCache;      /** pooled statistics of recent cluster selections, shared by computeDE and the row clicks */
   
     QSharedPointer<QTableItemModel>   _tableItemModel;
+    std::vector<qsizetype>            _tableRowDimensions;  /** matched dimension of every table row, empty when the rows are the matched dimensions */
+    cde::ResultTable                  _displayedResult;     /** key, sources and dimension matching of the table in the model, its cells stay in the model */
+    cde::ResultHistory                _resultHistory;       /** recently shown tables, by selection */
     QPointer<cde::SortFilterProxyModel>      _sortFilterProxyModel;
 
     //actions
     LoadedDatasetsAction                 _loadedDatasetsAction;
     StringAction                         _filterOnIdAction;
     ToggleAction                         _autoUpdateAction;
+    IntegralAction                       _autoUpdateDelayAction;
     StringAction                         _selectedIdAction;
     OptionAction                         _selectedDimensionAction;
     TriggerAction                        _updateStatisticsAction;
+    IntegralAction                       _statisticsTileSizeAction;
+    DecimalAction                        _sparseDensityThresholdAction;
+    ToggleAction                         _welchTestAction;
+    ToggleAction                         _rankSumTestAction;
+    IntegralAction                       _rankTestBlockSizeAction;
+    IntegralAction                       _statisticsDiskCacheSizeAction;
+    IntegralAction                       _streamingChunkRowsAction;
+    TriggerAction                        _computeMarkersAction;
+    IntegralAction                       _markersPerClusterAction;
+    TriggerAction                        _computePairwiseDEAction;
+    IntegralAction                       _pairwiseTopKAction;
+    IntegralAction                       _topKRowsAction;
+    ToggleAction                         _showAllRowsAction;
+    IntegralAction                       _resultHistorySizeAction;
+    StringAction                         _resultHistoryUsageAction;
     QVector<QPointer<StringAction>>      _meanExpressionDatasetGuidAction;
     QVector<QPointer<StringAction>>      _DE_StatisticsDatasetGuidAction;
     TriggerAction                        _copyToClipboardAction;
@@ -173,6 +287,27 @@ private:
     
     VariantAction                       _pairwiseDiffExpResultsAction;
 
+    mv::EventListener                   _eventListener;
+    QHash<QString, std::shared_ptr<const DE_StatisticsDatasets>> _DE_StatisticsDatasets; /** resolved DE_Statistics, by cluster dataset id */
+    QHash<QString, std::shared_ptr<cde::TrackedClusterStatistics>> _trackedStatistics;  /** accumulators of the DE_Statistics computed in this session, by cluster dataset id */
+    cde::StatisticsDiskCache                            _statisticsDiskCache;   /** accumulators of earlier sessions, shared with the worker thread */
+
+    std::unique_ptr<DEJob>                              _computeDEJob;      /** inputs of the running computation */
+    QFutureWatcher<std::shared_ptr<DEResult>>           _computeDEWatcher;
+    bool                                                _computeDERerun;    /** computeDE was called while the worker was running */
+    bool                                                _computeMarkersPending; /** computeMarkers was called while the worker was running */
+    QHash<QString, mv::Dataset<Clusters>>               _pendingStatisticsUpdates;  /** cluster datasets that changed while a worker was running, by id */
+    QHash<QString, mv::Dataset<Clusters>>               _pendingStatisticsRequests; /** cluster datasets whose missing DE_Statistics wait for a worker, by id */
+    QHash<QString, std::function<void()>>               _statisticsContinuations;   /** what waits for requested DE_Statistics, by purpose, see get_DE_Statistics */
+    std::unique_ptr<StatisticsUpdateJob>                _statisticsUpdateJob;       /** inputs and output of the running statistics update */
+    QFutureWatcher<bool>                                _statisticsUpdateWatcher;
+    std::unique_ptr<BatchJob>                           _batchJob;          /** the running marker or pairwise computation */
+    QFutureWatcher<void>                                _batchWatcher;
+    std::function<void()>                               _pendingBatchRequest;   /** made while the batch worker was running, made again once it has stopped */
+    QTimer                                              _autoUpdateTimer;   /** coalesces the selection changes of auto update */
+    std::uint64_t                                       _preInfoVersion;    /** incremented whenever the pre info columns change, part of the result key */
+    std::uint64_t                                       _postInfoVersion;
+
     
     
 };
@@ -0,0 +1,180 @@
+#include "ClusterStatistics.h"
+
+#include <cmath>
+#include <iterator>
+#include <limits>
+
+namespace cde {
+
+namespace {
+    // per-thread budget for the partial accumulators of one tile, conservative for the L2 caches we run on
+    constexpr std::size_t L2_TILE_BUDGET = 256 * 1024;
+    constexpr std::size_t MIN_TILE_SIZE = 8;
+    constexpr std::size_t BYTES_PER_ACCUMULATOR = 2 * sizeof(double) + sizeof(std::uint32_t);
+}
+
+std::size_t resolveTileSize(std::size_t numClusters, std::size_t numDimensions, std::size_t requestedTileSize)
+{
+    std::size_t tileSize = requestedTileSize;
+    if (tileSize == 0)
+        tileSize = std::max(MIN_TILE_SIZE, L2_TILE_BUDGET / (std::max<std::size_t>(numClusters, 1) * BYTES_PER_ACCUMULATOR));
+    return std::max<std::size_t>(1, std::min(tileSize, numDimensions));
+}
+
+std::size_t tileCount(std::size_t numDimensions, std::size_t tileSize)
+{
+    if (tileSize == 0)
+        return 0;
+    return (numDimensions + tileSize - 1) / tileSize;
+}
+
+std::size_t rowChunkCount(std::size_t numRows, std::size_t chunkRows)
+{
+    if (chunkRows == 0)
+        return 0;
+    return (numRows + chunkRows - 1) / chunkRows;
+}
+
+void ClusterStatistics::reset(std::size_t clusters, std::size_t dimensions)
+{
+    numClusters = clusters;
+    numDimensions = dimensions;
+    sums.assign(numClusters * numDimensions, 0);
+    sumOfSquares.assign(numClusters * numDimensions, 0);
+    nonZeroCounts.assign(numClusters * numDimensions, 0);
+    clusterSizes.assign(numClusters, 0);
+}
+
+void ClusterStatistics::resizeClusters(std::size_t clusters)
+{
+    numClusters = clusters;
+    sums.resize(numClusters * numDimensions, 0);
+    sumOfSquares.resize(numClusters * numDimensions, 0);
+    nonZeroCounts.resize(numClusters * numDimensions, 0);
+    clusterSizes.resize(numClusters, 0);
+}
+
+std::vector<float> ClusterStatistics::means() const
+{
+    std::vector<float> result(numClusters * numDimensions);
+
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (std::ptrdiff_t clusterIdx = 0; clusterIdx < static_cast<std::ptrdiff_t>(numClusters); ++clusterIdx)
+    {
+        const std::size_t offset = clusterIdx * numDimensions;
+        // an empty cluster yields 0/0, i.e. NaN, just like the dimension-outer loop this replaces
+        const double clusterSize = static_cast<double>(clusterSizes[clusterIdx]);
+        for (std::size_t dimension = 0; dimension < numDimensions; ++dimension)
+        {
+            result[offset + dimension] = static_cast<float>(sums[offset + dimension] / clusterSize);
+        }
+    }
+    return result;
+}
+
+std::vector<float> ClusterStatistics::variances() const
+{
+    std::vector<float> result(numClusters * numDimensions, 0);
+
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (std::ptrdiff_t clusterIdx = 0; clusterIdx < static_cast<std::ptrdiff_t>(numClusters); ++clusterIdx)
+    {
+        const std::size_t clusterSize = clusterSizes[clusterIdx];
+        if (clusterSize < 2)
+            continue;
+
+        const std::size_t offset = clusterIdx * numDimensions;
+        for (std::size_t dimension = 0; dimension < numDimensions; ++dimension)
+        {
+            const double sum = sums[offset + dimension];
+            const double sumOfSquaredDeviations = std::max(0.0, sumOfSquares[offset + dimension] - (sum * sum / clusterSize));
+            result[offset + dimension] = static_cast<float>(sumOfSquaredDeviations / (clusterSize - 1));
+        }
+    }
+    return result;
+}
+
+std::vector<float> ClusterStatistics::nonZeroFractions() const
+{
+    std::vector<float> result(numClusters * numDimensions);
+
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (std::ptrdiff_t clusterIdx = 0; clusterIdx < static_cast<std::ptrdiff_t>(numClusters); ++clusterIdx)
+    {
+        const std::size_t offset = clusterIdx * numDimensions;
+        const double clusterSize = static_cast<double>(clusterSizes[clusterIdx]);
+        for (std::size_t dimension = 0; dimension < numDimensions; ++dimension)
+        {
+            result[offset + dimension] = static_cast<float>(nonZeroCounts[offset + dimension] / clusterSize);
+        }
+    }
+    return result;
+}
+
+MembershipDelta membershipDelta(const std::vector<ClusterMember>& before, const std::vector<ClusterMember>& after)
+{
+    MembershipDelta delta;
+    std::set_difference(before.cbegin(), before.cend(), after.cbegin(), after.cend(), std::back_inserter(delta.removed));
+    std::set_difference(after.cbegin(), after.cend(), before.cbegin(), before.cend(), std::back_inserter(delta.added));
+    return delta;
+}
+
+GroupStatistics poolClusters(const ClusterTables& tables, const std::vector<unsigned>& selectedClusters)
+{
+    const std::ptrdiff_t numDimensions = static_cast<std::ptrdiff_t>(tables.numDimensions);
+    const double NaN = std::numeric_limits<double>::quiet_NaN();
+
+    GroupStatistics result;
+    for (auto clusterIdx : selectedClusters)
+        result.count += tables.clusterSizes[clusterIdx];
+
+    result.mean.assign(numDimensions, 0);
+    result.variance.assign(numDimensions, tables.variances ? 0 : NaN);
+    result.nonZeroFraction.assign(numDimensions, tables.nonZeroFractions ? 0 : NaN);
+
+    const double count = static_cast<double>(result.count);
+
+    #pragma omp parallel for schedule(static)
+    for (std::ptrdiff_t dimension = 0; dimension < numDimensions; ++dimension)
+    {
+        double mean = 0;
+        double nonZeros = 0;
+        for (auto clusterIdx : selectedClusters)
+        {
+            const std::size_t offset = (clusterIdx * tables.numDimensions) + dimension;
+            const double clusterSize = static_cast<double>(tables.clusterSizes[clusterIdx]);
+            if (clusterSize == 0)
+                continue;   // the means of an empty cluster are NaN
+            mean += tables.means[offset] * clusterSize;
+            if (tables.nonZeroFractions)
+                nonZeros += tables.nonZeroFractions[offset] * clusterSize;
+        }
+        if (count > 0)
+        {
+            mean /= count;
+            nonZeros /= count;
+        }
+        result.mean[dimension] = mean;
+
+        if (tables.nonZeroFractions)
+            result.nonZeroFraction[dimension] = nonZeros;
+
+        if (tables.variances)
+        {
+            double sumOfSquaredDeviations = 0;
+            for (auto clusterIdx : selectedClusters)
+            {
+                const std::size_t offset = (clusterIdx * tables.numDimensions) + dimension;
+                const double clusterSize = static_cast<double>(tables.clusterSizes[clusterIdx]);
+                if (clusterSize == 0)
+                    continue;
+                const double deviation = tables.means[offset] - mean;
+                sumOfSquaredDeviations += (std::max(0.0, clusterSize - 1) * tables.variances[offset]) + (clusterSize * deviation * deviation);
+            }
+            result.variance[dimension] = (result.count > 1) ? (sumOfSquaredDeviations / (count - 1)) : 0;
+        }
+    }
+    return result;
+}
+
+}
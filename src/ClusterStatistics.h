@@ -0,0 +1,338 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "RowKernels.h"
+
+namespace cde {
+
+/**
+ * Per-cluster accumulators backing the DE_Statistics child dataset of a cluster dataset.
+ * All tables are stored row-major: numClusters rows of numDimensions values.
+ */
+struct ClusterStatistics
+{
+    std::size_t                 numClusters = 0;
+    std::size_t                 numDimensions = 0;
+    std::vector<double>         sums;           /** per (cluster, dimension) sum of the expression values */
+    std::vector<double>         sumOfSquares;   /** per (cluster, dimension) sum of the squared expression values */
+    std::vector<std::uint32_t>  nonZeroCounts;  /** per (cluster, dimension) number of non-zero expression values */
+    std::vector<std::size_t>    clusterSizes;   /** number of points per cluster */
+
+    /** Clears all accumulators and resizes them for the given number of clusters and dimensions */
+    void reset(std::size_t clusters, std::size_t dimensions);
+
+    /** Changes the number of clusters, keeping the accumulators of the remaining clusters; new clusters start empty */
+    void resizeClusters(std::size_t clusters);
+
+    /** Returns the numClusters x numDimensions table of mean expressions */
+    std::vector<float> means() const;
+
+    /** Returns the numClusters x numDimensions table of sample variances, 0 for clusters of less than two points */
+    std::vector<float> variances() const;
+
+    /** Returns the numClusters x numDimensions table of the fraction of points with a non-zero expression */
+    std::vector<float> nonZeroFractions() const;
+};
+
+/** Statistics of the union of a selection of clusters, per dimension */
+struct GroupStatistics
+{
+    std::size_t                 count = 0;          /** total number of points in the selected clusters */
+    std::vector<double>         mean;
+    std::vector<double>         variance;           /** pooled sample variance, NaN when the per-cluster variances are not available */
+    std::vector<double>         nonZeroFraction;    /** NaN when the per-cluster non-zero fractions are not available */
+};
+
+/**
+ * Read-only view on the per-cluster tables as stored in the DE_Statistics datasets.
+ * variances and nonZeroFractions may be null for DE_Statistics computed before they were stored.
+ */
+struct ClusterTables
+{
+    std::size_t                 numClusters = 0;
+    std::size_t                 numDimensions = 0;
+    const float*                means = nullptr;
+    const float*                variances = nullptr;
+    const float*                nonZeroFractions = nullptr;
+    std::vector<std::size_t>    clusterSizes;
+};
+
+/**
+ * Merges the selected clusters into the statistics of their union, in O(selected x dimensions).
+ * The pooled variance combines the within-cluster variances with the spread of the cluster means around the pooled mean.
+ */
+GroupStatistics poolClusters(const ClusterTables& tables, const std::vector<unsigned>& selectedClusters);
+
+/**
+ * Returns the number of dimensions per tile used by accumulateClusterTiles.
+ * A requested size of 0 picks the widest tile for which the per-thread partial sums of all clusters fit in L2.
+ */
+std::size_t resolveTileSize(std::size_t numClusters, std::size_t numDimensions, std::size_t requestedTileSize);
+
+/** Returns the number of dimension tiles accumulateClusterTiles processes, i.e. the number of progress callbacks */
+std::size_t tileCount(std::size_t numDimensions, std::size_t tileSize);
+
+/** A (row, cluster) pair; a point can be a member of more than one cluster */
+using ClusterMember = std::pair<std::uint32_t, std::uint32_t>;
+
+/** (row, cluster) pairs of all cluster members, ordered by row and then by cluster */
+template<typename ClusterVector>
+std::vector<ClusterMember> clusterMembers(const ClusterVector& clusters)
+{
+    std::vector<ClusterMember> members;
+    for (std::size_t clusterIdx = 0; clusterIdx < clusters.size(); ++clusterIdx)
+    {
+        for (auto row : clusters[clusterIdx].getIndices())
+            members.emplace_back(static_cast<std::uint32_t>(row), static_cast<std::uint32_t>(clusterIdx));
+    }
+    std::sort(members.begin(), members.end());
+    return members;
+}
+
+/** Same as clusterMembers, also fills in the cluster sizes of the statistics */
+template<typename ClusterVector>
+std::vector<ClusterMember> collectClusterMembers(const ClusterVector& clusters, ClusterStatistics& statistics)
+{
+    for (std::size_t clusterIdx = 0; clusterIdx < clusters.size(); ++clusterIdx)
+        statistics.clusterSizes[clusterIdx] = clusters[clusterIdx].getIndices().size();
+    return clusterMembers(clusters);
+}
+
+/** Cluster members that left or joined a cluster between two snapshots taken with clusterMembers */
+struct MembershipDelta
+{
+    std::vector<ClusterMember>  removed;
+    std::vector<ClusterMember>  added;
+
+    std::size_t size() const { return removed.size() + added.size(); }
+};
+
+MembershipDelta membershipDelta(const std::vector<ClusterMember>& before, const std::vector<ClusterMember>& after);
+
+/** Accumulators of a cluster dataset together with the membership they were computed for */
+struct TrackedClusterStatistics
+{
+    ClusterStatistics           statistics;
+    std::vector<ClusterMember>  members;
+};
+
+/**
+ * Drives the tiled aggregation shared by the accumulateClusterTiles overloads.
+ * addRow(row, sums, sumOfSquares, nonZeroCounts, firstDimension, width) accumulates the dimensions [firstDimension, firstDimension + width) of a point row.
+ * progress(tile) is called after every tile and returns false to stop, leaving the remaining tiles unaccumulated.
+ */
+template<typename ClusterVector, typename AddRow, typename ProgressFunction>
+void accumulateTiles(const ClusterVector& clusters, ClusterStatistics& statistics, std::size_t numDimensions, std::size_t tileSize, AddRow addRow, ProgressFunction progress)
+{
+    const std::size_t numClusters = clusters.size();
+    statistics.reset(numClusters, numDimensions);
+
+    const auto members = collectClusterMembers(clusters, statistics);
+    const std::ptrdiff_t numMembers = static_cast<std::ptrdiff_t>(members.size());
+    const std::size_t tileWidth = resolveTileSize(numClusters, numDimensions, tileSize);
+    const std::size_t numTiles = tileCount(numDimensions, tileWidth);
+
+    for (std::size_t tile = 0; tile < numTiles; ++tile)
+    {
+        const std::size_t firstDimension = tile * tileWidth;
+        const std::size_t width = std::min(tileWidth, numDimensions - firstDimension);
+
+        #pragma omp parallel
+        {
+            std::vector<double> partialSums(numClusters * width, 0);
+            std::vector<double> partialSumOfSquares(numClusters * width, 0);
+            std::vector<std::uint32_t> partialNonZeroCounts(numClusters * width, 0);
+
+            #pragma omp for schedule(static)
+            for (std::ptrdiff_t member = 0; member < numMembers; ++member)
+            {
+                const std::size_t offset = members[member].second * width;
+                addRow(members[member].first, partialSums.data() + offset, partialSumOfSquares.data() + offset, partialNonZeroCounts.data() + offset, firstDimension, width);
+            }
+
+            #pragma omp critical
+            for (std::size_t clusterIdx = 0; clusterIdx < numClusters; ++clusterIdx)
+            {
+                const std::size_t offset = (clusterIdx * numDimensions) + firstDimension;
+                const std::size_t partialOffset = clusterIdx * width;
+                for (std::size_t d = 0; d < width; ++d)
+                {
+                    statistics.sums[offset + d] += partialSums[partialOffset + d];
+                    statistics.sumOfSquares[offset + d] += partialSumOfSquares[partialOffset + d];
+                    statistics.nonZeroCounts[offset + d] += partialNonZeroCounts[partialOffset + d];
+                }
+            }
+        }
+        if (!progress(tile))
+            return;
+    }
+}
+
+/** Returns the number of row chunks accumulateRowChunks processes, i.e. the number of progress callbacks */
+std::size_t rowChunkCount(std::size_t numRows, std::size_t chunkRows);
+
+/**
+ * Streaming alternative to accumulateTiles that reads the point rows once, front to back, in chunks of chunkRows rows.
+ * Within a chunk the dimensions are split into tiles over the threads, each thread adding the chunk's cluster members
+ * straight into its own columns of the accumulators, so no partial accumulators are allocated and a chunk is the only
+ * part of the point data in use at any time.
+ * addRow is used as in accumulateTiles; progress(chunk) is called after every chunk and returns false to stop.
+ */
+template<typename ClusterVector, typename AddRow, typename ProgressFunction>
+void accumulateRowChunks(const ClusterVector& clusters, ClusterStatistics& statistics, std::size_t numDimensions, std::size_t numRows, std::size_t chunkRows, AddRow addRow, ProgressFunction progress)
+{
+    constexpr std::size_t CHUNK_TILE_SIZE = 256;
+    statistics.reset(clusters.size(), numDimensions);
+
+    const auto members = collectClusterMembers(clusters, statistics);
+    const std::size_t numChunks = rowChunkCount(numRows, chunkRows);
+    const std::ptrdiff_t numTiles = static_cast<std::ptrdiff_t>(tileCount(numDimensions, CHUNK_TILE_SIZE));
+
+    auto chunkBegin = members.cbegin();
+    for (std::size_t chunk = 0; chunk < numChunks; ++chunk)
+    {
+        // the members are ordered by row, so the members of a chunk are a contiguous range
+        const std::uint32_t endRow = static_cast<std::uint32_t>(std::min(numRows, (chunk + 1) * chunkRows));
+        const auto chunkEnd = std::lower_bound(chunkBegin, members.cend(), ClusterMember(endRow, 0));
+
+        #pragma omp parallel for schedule(dynamic, 1)
+        for (std::ptrdiff_t tile = 0; tile < numTiles; ++tile)
+        {
+            const std::size_t firstDimension = tile * CHUNK_TILE_SIZE;
+            const std::size_t width = std::min(CHUNK_TILE_SIZE, numDimensions - firstDimension);
+            for (auto member = chunkBegin; member != chunkEnd; ++member)
+            {
+                const std::size_t offset = (member->second * numDimensions) + firstDimension;
+                addRow(member->first, statistics.sums.data() + offset, statistics.sumOfSquares.data() + offset, statistics.nonZeroCounts.data() + offset, firstDimension, width);
+            }
+        }
+        chunkBegin = chunkEnd;
+
+        if (!progress(chunk))
+            return;
+    }
+}
+
+/**
+ * Applies a membership delta to the accumulators: the rows that left a cluster are subtracted from it and the rows that
+ * joined one are added, so only the moved rows are read. Clusters are added or dropped at the end to match numClusters.
+ * The dimensions are split into tiles that are updated in parallel, addRow is used as in accumulateTiles.
+ */
+template<typename AddRow>
+void applyMembershipDelta(ClusterStatistics& statistics, const MembershipDelta& delta, std::size_t numClusters, AddRow addRow)
+{
+    // grow first so the rows joining a new cluster have accumulators, shrink once the rows of dropped clusters are subtracted
+    if (numClusters > statistics.numClusters)
+        statistics.resizeClusters(numClusters);
+
+    constexpr std::size_t DELTA_TILE_SIZE = 256;
+    const std::size_t numDimensions = statistics.numDimensions;
+    const std::ptrdiff_t numTiles = static_cast<std::ptrdiff_t>(tileCount(numDimensions, DELTA_TILE_SIZE));
+
+    #pragma omp parallel
+    {
+        std::vector<double> rowSums(DELTA_TILE_SIZE);
+        std::vector<double> rowSumOfSquares(DELTA_TILE_SIZE);
+        std::vector<std::uint32_t> rowNonZeroCounts(DELTA_TILE_SIZE);
+
+        #pragma omp for schedule(dynamic, 1)
+        for (std::ptrdiff_t tile = 0; tile < numTiles; ++tile)
+        {
+            const std::size_t firstDimension = tile * DELTA_TILE_SIZE;
+            const std::size_t width = std::min(DELTA_TILE_SIZE, numDimensions - firstDimension);
+
+            for (const auto& member : delta.removed)
+            {
+                std::fill_n(rowSums.begin(), width, 0.0);
+                std::fill_n(rowSumOfSquares.begin(), width, 0.0);
+                std::fill_n(rowNonZeroCounts.begin(), width, 0u);
+                addRow(member.first, rowSums.data(), rowSumOfSquares.data(), rowNonZeroCounts.data(), firstDimension, width);
+
+                const std::size_t offset = (member.second * numDimensions) + firstDimension;
+                for (std::size_t d = 0; d < width; ++d)
+                {
+                    statistics.sums[offset + d] -= rowSums[d];
+                    statistics.sumOfSquares[offset + d] -= rowSumOfSquares[d];
+                    statistics.nonZeroCounts[offset + d] -= rowNonZeroCounts[d];
+                }
+            }
+            for (const auto& member : delta.added)
+            {
+                const std::size_t offset = (member.second * numDimensions) + firstDimension;
+                addRow(member.first, statistics.sums.data() + offset, statistics.sumOfSquares.data() + offset, statistics.nonZeroCounts.data() + offset, firstDimension, width);
+            }
+        }
+    }
+
+    for (const auto& member : delta.removed)
+        --statistics.clusterSizes[member.second];
+    for (const auto& member : delta.added)
+        ++statistics.clusterSizes[member.second];
+
+    if (numClusters < statistics.numClusters)
+        statistics.resizeClusters(numClusters);
+}
+
+/** Adds the dimensions [firstDimension, firstDimension + width) of a row of a point view to the accumulators */
+template<typename PointView>
+auto pointViewRowAdder(const PointView& vec)
+{
+    return [&vec](std::uint32_t row, double* sums, double* sumOfSquares, std::uint32_t* nonZeroCounts, std::size_t firstDimension, std::size_t width)
+        {
+            const auto point = vec[row];
+            for (std::size_t d = 0; d < width; ++d)
+            {
+                const double value = point[firstDimension + d];
+                sums[d] += value;
+                sumOfSquares[d] += value * value;
+                nonZeroCounts[d] += (value != 0.0);
+            }
+        };
+}
+
+/** Same as pointViewRowAdder for a contiguous row-major array, using the SIMD kernel selected at runtime for T */
+template<typename T>
+auto contiguousRowAdder(const T* data, std::size_t numDimensions)
+{
+    const AddRowFunction addRowFunction = selectAddRowFunction(elementTypeOf<T>());
+    return [data, addRowFunction, numDimensions](std::uint32_t row, double* sums, double* sumOfSquares, std::uint32_t* nonZeroCounts, std::size_t firstDimension, std::size_t width)
+        {
+            addRowFunction(data + (static_cast<std::size_t>(row) * numDimensions) + firstDimension, sums, sumOfSquares, nonZeroCounts, width);
+        };
+}
+
+/**
+ * Computes the per-cluster sums, sums of squares and non-zero counts in blocks of (point rows x dimension range).
+ * The dimensions are split into tiles; for every tile each thread streams a contiguous block of point rows
+ * into its own numClusters x tileSize partial accumulators, which are reduced into the statistics once per tile.
+ * Point rows are visited in storage order, so every tile reads the matrix front to back.
+ *
+ * @param vec Point view as handed out by Points::visitData
+ * @param clusters Clusters of the cluster dataset, indices refer to rows of vec
+ * @param statistics Accumulators, reset by this function
+ * @param numDimensions Number of dimensions of the points
+ * @param tileSize Number of dimensions per tile, see resolveTileSize
+ * @param progress Called with the tile index once a tile has been processed, returns false to stop early
+ */
+template<typename PointView, typename ClusterVector, typename ProgressFunction>
+void accumulateClusterTiles(const PointView& vec, const ClusterVector& clusters, ClusterStatistics& statistics, std::size_t numDimensions, std::size_t tileSize, ProgressFunction progress)
+{
+    accumulateTiles(clusters, statistics, numDimensions, tileSize, pointViewRowAdder(vec), progress);
+}
+
+/**
+ * Same as above for point data stored as one contiguous row-major array of element type T.
+ * Rows are added with the SIMD kernel selected at runtime for T, see RowKernels.h.
+ */
+template<typename T, typename ClusterVector, typename ProgressFunction>
+void accumulateContiguousClusterTiles(const T* data, const ClusterVector& clusters, ClusterStatistics& statistics, std::size_t numDimensions, std::size_t tileSize, ProgressFunction progress)
+{
+    accumulateTiles(clusters, statistics, numDimensions, tileSize, contiguousRowAdder(data, numDimensions), progress);
+}
+
+}
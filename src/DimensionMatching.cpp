@@ -0,0 +1,93 @@
+#include "DimensionMatching.h"
+
+#include <QHash>
+#include <QHashFunctions>
+
+#include <algorithm>
+
+namespace cde {
+
+DimensionMatching matchDimensionNames(const std::vector<std::vector<QString>>& dimensionNames)
+{
+    DimensionMatching matching;
+    matching.numDatasets = dimensionNames.size();
+
+    matching.identical = std::all_of(dimensionNames.cbegin(), dimensionNames.cend(), [&dimensionNames](const std::vector<QString>& names)
+        {
+            return names == dimensionNames.front();
+        });
+    if (matching.identical)
+        return matching;
+
+    // position of every dimension of every dataset in the union of the names
+    QHash<QString, std::int32_t> unionIndices;
+    unionIndices.reserve(static_cast<qsizetype>(dimensionNames.front().size()));
+    std::vector<std::vector<std::int32_t>> positions(matching.numDatasets);
+    for (std::size_t dataset = 0; dataset < matching.numDatasets; ++dataset)
+    {
+        const std::vector<QString>& names = dimensionNames[dataset];
+        positions[dataset].resize(names.size());
+        for (std::size_t dimension = 0; dimension < names.size(); ++dimension)
+        {
+            auto found = unionIndices.constFind(names[dimension]);
+            if (found == unionIndices.cend())
+            {
+                found = unionIndices.insert(names[dimension], static_cast<std::int32_t>(matching.names.size()));
+                matching.names.push_back(names[dimension]);
+            }
+            positions[dataset][dimension] = found.value();
+        }
+    }
+
+    const std::size_t numMatched = matching.names.size();
+    matching.indices.assign(matching.numDatasets * numMatched, -1);
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (std::ptrdiff_t dataset = 0; dataset < static_cast<std::ptrdiff_t>(matching.numDatasets); ++dataset)
+    {
+        std::int32_t* gatherTable = matching.indices.data() + (dataset * numMatched);
+        const std::vector<std::int32_t>& datasetPositions = positions[dataset];
+        for (std::size_t dimension = 0; dimension < datasetPositions.size(); ++dimension)
+        {
+            std::int32_t& index = gatherTable[datasetPositions[dimension]];
+            if (index < 0)
+                index = static_cast<std::int32_t>(dimension);
+        }
+    }
+    return matching;
+}
+
+std::size_t dimensionNamesFingerprint(const std::vector<std::vector<QString>>& dimensionNames)
+{
+    std::size_t fingerprint = qHash(dimensionNames.size());
+    for (const auto& names : dimensionNames)
+        fingerprint = qHashMulti(fingerprint, names.size(), qHashRange(names.cbegin(), names.cend()));
+    return fingerprint;
+}
+
+std::shared_ptr<const DimensionMatching> DimensionMatchingCache::find(const std::vector<std::vector<QString>>& dimensionNames)
+{
+    const std::size_t fingerprint = dimensionNamesFingerprint(dimensionNames);
+    auto found = std::find_if(_entries.begin(), _entries.end(), [fingerprint, &dimensionNames](const Entry& entry)
+        {
+            return (entry.fingerprint == fingerprint) && (entry.dimensionNames == dimensionNames);
+        });
+    if (found == _entries.end())
+        return nullptr;
+
+    std::rotate(found, found + 1, _entries.end());
+    return _entries.back().matching;
+}
+
+void DimensionMatchingCache::insert(const std::vector<std::vector<QString>>& dimensionNames, std::shared_ptr<const DimensionMatching> matching)
+{
+    if (find(dimensionNames))
+    {
+        _entries.back().matching = std::move(matching);
+        return;
+    }
+    if (_entries.size() == CAPACITY)
+        _entries.erase(_entries.begin());
+    _entries.push_back({ dimensionNamesFingerprint(dimensionNames), dimensionNames, std::move(matching) });
+}
+
+}
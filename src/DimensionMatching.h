@@ -0,0 +1,70 @@
+#pragma once
+
+#include <QString>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace cde {
+
+/**
+ * Dimensions of several datasets matched by name.
+ * The matched dimensions are the union of the dimension names of all datasets: the names of the first dataset in their
+ * original order, followed by the names that only occur in later datasets in order of appearance.
+ */
+struct DimensionMatching
+{
+    bool                        identical = false;  /** all datasets have the same dimension names in the same order, names and indices are left empty */
+    std::size_t                 numDatasets = 0;
+    std::vector<QString>        names;              /** name of every matched dimension */
+    std::vector<std::int32_t>   indices;            /** one gather table per dataset, see gatherTable */
+
+    std::size_t size() const { return names.size(); }
+
+    /** Index of the matched dimension in the dataset, -1 when the dataset does not have a dimension with that name */
+    std::int32_t index(std::size_t dimension, std::size_t dataset) const { return indices[(dataset * names.size()) + dimension]; }
+
+    /** Contiguous table with the dimension index in the dataset of every matched dimension, -1 for the missing ones */
+    const std::int32_t* gatherTable(std::size_t dataset) const { return indices.data() + (dataset * names.size()); }
+};
+
+/**
+ * Matches the dimensions of the datasets by name.
+ * Every list is hashed once, so matching is linear in the total number of dimension names.
+ * When a name occurs more than once in a dataset, its first occurrence is used.
+ */
+DimensionMatching matchDimensionNames(const std::vector<std::vector<QString>>& dimensionNames);
+
+/** Hash of the dimension-name lists, used to look up earlier matchings of the same lists */
+std::size_t dimensionNamesFingerprint(const std::vector<std::vector<QString>>& dimensionNames);
+
+/**
+ * Matchings of the most recently matched dimension-name lists.
+ * Entries are looked up by fingerprint and verified against the stored lists, which share their strings with the datasets.
+ */
+class DimensionMatchingCache
+{
+public:
+    /** Returns the matching of exactly these dimension-name lists, or nullptr when they were not matched recently */
+    std::shared_ptr<const DimensionMatching> find(const std::vector<std::vector<QString>>& dimensionNames);
+
+    /** Adds the matching, evicting the least recently used entry when the cache is full */
+    void insert(const std::vector<std::vector<QString>>& dimensionNames, std::shared_ptr<const DimensionMatching> matching);
+
+    void clear() { _entries.clear(); }
+
+private:
+    struct Entry
+    {
+        std::size_t                                 fingerprint;
+        std::vector<std::vector<QString>>           dimensionNames;
+        std::shared_ptr<const DimensionMatching>    matching;
+    };
+
+    static constexpr std::size_t CAPACITY = 8;
+    std::vector<Entry>  _entries;   /** most recently used last */
+};
+
+}
@@ -0,0 +1,47 @@
+#include "GroupStatisticsCache.h"
+
+#include <algorithm>
+
+namespace cde {
+
+std::shared_ptr<const GroupStatistics> GroupStatisticsCache::find(const QString& clusterDatasetId, const std::vector<unsigned>& selectedClusters, const std::shared_ptr<const void>& source)
+{
+    if (!source)
+        return nullptr;
+
+    auto found = std::find_if(_entries.begin(), _entries.end(), [&clusterDatasetId, &selectedClusters](const Entry& entry)
+        {
+            return (entry.clusterDatasetId == clusterDatasetId) && (entry.selectedClusters == selectedClusters);
+        });
+    if (found == _entries.end())
+        return nullptr;
+
+    // a locked weak_ptr is still the same object, an expired one can never compare equal to a replacement at its address
+    if (found->source.lock() != source)
+    {
+        _entries.erase(found);
+        return nullptr;
+    }
+
+    std::rotate(found, found + 1, _entries.end());
+    return _entries.back().statistics;
+}
+
+void GroupStatisticsCache::insert(const QString& clusterDatasetId, const std::vector<unsigned>& selectedClusters, const std::shared_ptr<const void>& source, std::shared_ptr<const GroupStatistics> statistics)
+{
+    if (!source || !statistics)
+        return;
+
+    auto found = std::find_if(_entries.begin(), _entries.end(), [&clusterDatasetId, &selectedClusters](const Entry& entry)
+        {
+            return (entry.clusterDatasetId == clusterDatasetId) && (entry.selectedClusters == selectedClusters);
+        });
+    if (found != _entries.end())
+        _entries.erase(found);
+    else if (_entries.size() == CAPACITY)
+        _entries.erase(_entries.begin());
+
+    _entries.push_back({ clusterDatasetId, selectedClusters, source, std::move(statistics) });
+}
+
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "ClusterStatistics.h"
+
+#include <QString>
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace cde {
+
+/**
+ * Pooled statistics of the most recently used cluster selections, by cluster dataset id and sorted cluster indices.
+ * Every entry is versioned by the per-cluster statistics it was pooled from: it only matches as long as the caller
+ * still passes that same object, so an entry goes stale as soon as the DE_Statistics of its dataset are replaced.
+ */
+class GroupStatisticsCache
+{
+public:
+    /** Returns the statistics pooled from source for exactly these clusters, or nullptr when there are none */
+    std::shared_ptr<const GroupStatistics> find(const QString& clusterDatasetId, const std::vector<unsigned>& selectedClusters, const std::shared_ptr<const void>& source);
+
+    /** Adds the statistics, evicting the least recently used entry when the cache is full */
+    void insert(const QString& clusterDatasetId, const std::vector<unsigned>& selectedClusters, const std::shared_ptr<const void>& source, std::shared_ptr<const GroupStatistics> statistics);
+
+    void clear() { _entries.clear(); }
+
+private:
+    struct Entry
+    {
+        QString                                 clusterDatasetId;
+        std::vector<unsigned>                   selectedClusters;   /** sorted */
+        std::weak_ptr<const void>               source;             /** the version, not kept alive by the cache */
+        std::shared_ptr<const GroupStatistics>  statistics;
+    };
+
+    static constexpr std::size_t CAPACITY = 32;
+    std::vector<Entry>  _entries;   /** most recently used last */
+};
+
+}
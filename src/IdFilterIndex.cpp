@@ -0,0 +1,126 @@
+#include "IdFilterIndex.h"
+
+#include <QRegularExpression>
+
+#include <algorithm>
+#include <iterator>
+
+namespace cde {
+
+namespace {
+    constexpr qsizetype TRIGRAM_LENGTH = 3;
+
+    quint64 trigramKey(const QChar* characters)
+    {
+        return (quint64(characters[0].unicode()) << 32) | (quint64(characters[1].unicode()) << 16) | quint64(characters[2].unicode());
+    }
+}
+
+void IdFilterIndex::build(const std::vector<QString>& ids)
+{
+    clear();
+
+    m_ids.resize(ids.size());
+    m_rowsById.reserve(static_cast<qsizetype>(ids.size()));
+    for (std::size_t row = 0; row < ids.size(); ++row)
+    {
+        m_ids[row] = ids[row].toLower();
+        const QString& id = m_ids[row];
+        m_rowsById[id].push_back(static_cast<std::uint32_t>(row));
+
+        // rows are visited in order, so a row that repeats a trigram is already the last entry of its list
+        for (qsizetype position = 0; position + TRIGRAM_LENGTH <= id.size(); ++position)
+        {
+            std::vector<std::uint32_t>& rows = m_rowsByTrigram[trigramKey(id.constData() + position)];
+            if (rows.empty() || (rows.back() != row))
+                rows.push_back(static_cast<std::uint32_t>(row));
+        }
+    }
+}
+
+void IdFilterIndex::clear()
+{
+    m_ids.clear();
+    m_rowsById.clear();
+    m_rowsByTrigram.clear();
+}
+
+std::size_t IdFilterIndex::size() const
+{
+    return m_ids.size();
+}
+
+const QString& IdFilterIndex::id(std::size_t row) const
+{
+    return m_ids[row];
+}
+
+std::vector<std::uint32_t> IdFilterIndex::containing(const QString& text) const
+{
+    std::vector<std::uint32_t> result;
+    const QString needle = text.toLower();
+
+    if (needle.size() < TRIGRAM_LENGTH)
+    {
+        for (std::size_t row = 0; row < m_ids.size(); ++row)
+        {
+            if (m_ids[row].contains(needle))
+                result.push_back(static_cast<std::uint32_t>(row));
+        }
+        return result;
+    }
+
+    // every match holds all trigrams of the needle, so the shortest posting list bounds the work
+    const std::vector<std::uint32_t>* candidates = nullptr;
+    for (qsizetype position = 0; position + TRIGRAM_LENGTH <= needle.size(); ++position)
+    {
+        auto found = m_rowsByTrigram.constFind(trigramKey(needle.constData() + position));
+        if (found == m_rowsByTrigram.constEnd())
+            return result;
+        if ((candidates == nullptr) || (found->size() < candidates->size()))
+            candidates = &found.value();
+    }
+
+    for (std::uint32_t row : *candidates)
+    {
+        if (m_ids[row].contains(needle))
+            result.push_back(row);
+    }
+    return result;
+}
+
+std::vector<std::uint32_t> IdFilterIndex::matchingAny(const QStringList& ids) const
+{
+    std::vector<std::uint32_t> result;
+    for (const QString& id : ids)
+    {
+        auto found = m_rowsById.constFind(id.toLower());
+        if (found != m_rowsById.constEnd())
+            result.insert(result.end(), found->cbegin(), found->cend());
+    }
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return result;
+}
+
+std::vector<std::uint32_t> IdFilterIndex::matching(const QRegularExpression& expression) const
+{
+    std::vector<std::uint32_t> result;
+    for (std::size_t row = 0; row < m_ids.size(); ++row)
+    {
+        if (m_ids[row].contains(expression))
+            result.push_back(static_cast<std::uint32_t>(row));
+    }
+    return result;
+}
+
+QStringList idListFromText(const QString& text)
+{
+    static const QRegularExpression separators("[\\s,;]+");
+    QStringList ids = text.split(separators, Qt::SkipEmptyParts);
+    if (ids.size() < 2)
+        ids.clear();
+    return ids;
+}
+
+}
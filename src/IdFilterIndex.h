@@ -0,0 +1,52 @@
+#pragma once
+
+#include <QHash>
+#include <QString>
+#include <QStringList>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class QRegularExpression;
+
+namespace cde {
+
+/**
+ * Case-insensitive lookup of the rows of a table by their ID, built once per table so filtering does not have to visit
+ * every row. Substrings are looked up through a trigram index, the candidate rows of the rarest trigram are then checked
+ * one by one; complete IDs are looked up in a hash table. All results are row indices in increasing order.
+ */
+class IdFilterIndex
+{
+public:
+    void build(const std::vector<QString>& ids);
+    void clear();
+
+    std::size_t size() const;
+
+    /** The ID of the row as it is indexed, i.e. in lower case */
+    const QString& id(std::size_t row) const;
+
+    /** Rows whose ID contains text */
+    std::vector<std::uint32_t> containing(const QString& text) const;
+
+    /** Rows whose ID equals one of ids */
+    std::vector<std::uint32_t> matchingAny(const QStringList& ids) const;
+
+    /** Rows whose ID matches the expression, visits every row */
+    std::vector<std::uint32_t> matching(const QRegularExpression& expression) const;
+
+private:
+    std::vector<QString>                            m_ids;
+    QHash<QString, std::vector<std::uint32_t>>      m_rowsById;
+    QHash<quint64, std::vector<std::uint32_t>>      m_rowsByTrigram;
+};
+
+/**
+ * Splits a pasted list of IDs separated by newlines, commas, semicolons, tabs or spaces.
+ * Returns an empty list when the text holds a single ID, which is then to be searched for as a substring.
+ */
+QStringList idListFromText(const QString& text);
+
+}
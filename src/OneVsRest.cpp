@@ -0,0 +1,182 @@
+#include "OneVsRest.h"
+
+#include "StatisticalTests.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+namespace cde {
+
+namespace {
+    /** Pooled count, sum and sum of squared deviations from the pooled mean of all clusters, per dimension */
+    struct PooledTotals
+    {
+        double              count = 0;
+        std::vector<double> sums;
+        std::vector<double> mean;
+        std::vector<double> squaredDeviations;
+        std::vector<double> nonZeros;
+    };
+
+    PooledTotals poolAllClusters(const ClusterTables& tables)
+    {
+        const std::size_t numClusters = tables.numClusters;
+        const std::ptrdiff_t numDimensions = static_cast<std::ptrdiff_t>(tables.numDimensions);
+
+        PooledTotals totals;
+        for (std::size_t clusterIdx = 0; clusterIdx < numClusters; ++clusterIdx)
+            totals.count += static_cast<double>(tables.clusterSizes[clusterIdx]);
+
+        totals.sums.assign(numDimensions, 0);
+        totals.mean.assign(numDimensions, 0);
+        totals.squaredDeviations.assign(numDimensions, 0);
+        totals.nonZeros.assign(numDimensions, 0);
+
+        #pragma omp parallel for schedule(static)
+        for (std::ptrdiff_t dimension = 0; dimension < numDimensions; ++dimension)
+        {
+            double sum = 0;
+            double nonZeros = 0;
+            for (std::size_t clusterIdx = 0; clusterIdx < numClusters; ++clusterIdx)
+            {
+                const std::size_t offset = (clusterIdx * tables.numDimensions) + dimension;
+                const double clusterSize = static_cast<double>(tables.clusterSizes[clusterIdx]);
+                if (clusterSize == 0)
+                    continue;   // the means of an empty cluster are NaN
+                sum += tables.means[offset] * clusterSize;
+                if (tables.nonZeroFractions)
+                    nonZeros += tables.nonZeroFractions[offset] * clusterSize;
+            }
+            const double mean = (totals.count > 0) ? (sum / totals.count) : 0;
+
+            double squaredDeviations = 0;
+            if (tables.variances)
+            {
+                for (std::size_t clusterIdx = 0; clusterIdx < numClusters; ++clusterIdx)
+                {
+                    const std::size_t offset = (clusterIdx * tables.numDimensions) + dimension;
+                    const double clusterSize = static_cast<double>(tables.clusterSizes[clusterIdx]);
+                    if (clusterSize == 0)
+                        continue;
+                    const double deviation = tables.means[offset] - mean;
+                    squaredDeviations += (std::max(0.0, clusterSize - 1) * tables.variances[offset]) + (clusterSize * deviation * deviation);
+                }
+            }
+            totals.sums[dimension] = sum;
+            totals.mean[dimension] = mean;
+            totals.squaredDeviations[dimension] = squaredDeviations;
+            totals.nonZeros[dimension] = nonZeros;
+        }
+        return totals;
+    }
+}
+
+std::vector<OneVsRestMarker> oneVsRestMarkers(const ClusterTables& tables, std::size_t markersPerCluster)
+{
+    const std::size_t numClusters = tables.numClusters;
+    const std::size_t numDimensions = tables.numDimensions;
+    const std::size_t numMarkers = std::min(markersPerCluster, numDimensions);
+    const double NaN = std::numeric_limits<double>::quiet_NaN();
+    const bool hasVariances = (tables.variances != nullptr);
+
+    const PooledTotals totals = poolAllClusters(tables);
+
+    std::vector<std::vector<OneVsRestMarker>> clusterMarkers(numClusters);
+
+    #pragma omp parallel
+    {
+        std::vector<double> restMean(numDimensions);
+        std::vector<double> restVariance(numDimensions);
+        std::vector<double> score(numDimensions);
+        std::vector<std::uint32_t> order(numDimensions);
+
+        #pragma omp for schedule(dynamic, 1)
+        for (std::ptrdiff_t clusterIdx = 0; clusterIdx < static_cast<std::ptrdiff_t>(numClusters); ++clusterIdx)
+        {
+            const double clusterSize = static_cast<double>(tables.clusterSizes[clusterIdx]);
+            const double restSize = totals.count - clusterSize;
+            if ((clusterSize == 0) || (restSize <= 0) || (numMarkers == 0))
+                continue;
+
+            const float* means = tables.means + (clusterIdx * numDimensions);
+            const float* variances = hasVariances ? (tables.variances + (clusterIdx * numDimensions)) : nullptr;
+
+            // the rest is the pooled total minus the cluster; deviations are taken from the pooled mean to keep the subtraction stable
+            for (std::size_t dimension = 0; dimension < numDimensions; ++dimension)
+            {
+                const double mean = means[dimension];
+                const double rest = (totals.sums[dimension] - (mean * clusterSize)) / restSize;
+                restMean[dimension] = rest;
+                score[dimension] = mean - rest;
+            }
+            if (hasVariances)
+            {
+                for (std::size_t dimension = 0; dimension < numDimensions; ++dimension)
+                {
+                    const double clusterDeviation = means[dimension] - totals.mean[dimension];
+                    const double restDeviation = restMean[dimension] - totals.mean[dimension];
+                    const double clusterSquaredDeviations = (std::max(0.0, clusterSize - 1) * variances[dimension]) + (clusterSize * clusterDeviation * clusterDeviation);
+                    const double restSquaredDeviations = std::max(0.0, totals.squaredDeviations[dimension] - clusterSquaredDeviations - (restSize * restDeviation * restDeviation));
+                    restVariance[dimension] = (restSize > 1) ? (restSquaredDeviations / (restSize - 1)) : 0;
+
+                    const double standardError = std::sqrt((variances[dimension] / clusterSize) + (restVariance[dimension] / restSize));
+                    score[dimension] = (standardError > 0) ? (score[dimension] / standardError) : NaN;
+                }
+            }
+
+            // NaN scores rank last
+            std::iota(order.begin(), order.end(), 0u);
+            const auto higherScore = [&score](std::uint32_t a, std::uint32_t b)
+            {
+                if (std::isnan(score[b]))
+                    return !std::isnan(score[a]);
+                return score[a] > score[b];
+            };
+            std::nth_element(order.begin(), order.begin() + (numMarkers - 1), order.end(), higherScore);
+            std::sort(order.begin(), order.begin() + numMarkers, higherScore);
+
+            std::vector<OneVsRestMarker>& markers = clusterMarkers[clusterIdx];
+            markers.reserve(numMarkers);
+            for (std::size_t rank = 0; rank < numMarkers; ++rank)
+            {
+                const std::uint32_t dimension = order[rank];
+                OneVsRestMarker marker;
+                marker.cluster = static_cast<std::uint32_t>(clusterIdx);
+                marker.dimension = dimension;
+                marker.rank = static_cast<std::uint32_t>(rank);
+                marker.clusterMean = means[dimension];
+                marker.restMean = restMean[dimension];
+                marker.t = NaN;
+                marker.pValue = NaN;
+                if (hasVariances)
+                {
+                    const WelchTestResult welch = welchTTest(marker.clusterMean, variances[dimension], tables.clusterSizes[clusterIdx],
+                                                             marker.restMean, restVariance[dimension], static_cast<std::size_t>(restSize));
+                    marker.t = welch.t;
+                    marker.pValue = welch.pValue;
+                }
+                if (tables.nonZeroFractions)
+                {
+                    marker.clusterNonZeroFraction = tables.nonZeroFractions[(clusterIdx * numDimensions) + dimension];
+                    marker.restNonZeroFraction = (totals.nonZeros[dimension] - (marker.clusterNonZeroFraction * clusterSize)) / restSize;
+                }
+                else
+                {
+                    marker.clusterNonZeroFraction = NaN;
+                    marker.restNonZeroFraction = NaN;
+                }
+                markers.push_back(marker);
+            }
+        }
+    }
+
+    std::vector<OneVsRestMarker> result;
+    result.reserve(numClusters * numMarkers);
+    for (auto& markers : clusterMarkers)
+        result.insert(result.end(), markers.cbegin(), markers.cend());
+    return result;
+}
+
+}
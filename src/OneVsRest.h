@@ -0,0 +1,34 @@
+#pragma once
+
+#include "ClusterStatistics.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace cde {
+
+/** A dimension that marks a cluster: its expression in the cluster compared to the union of all other clusters */
+struct OneVsRestMarker
+{
+    std::uint32_t   cluster;
+    std::uint32_t   dimension;
+    std::uint32_t   rank;                       /** 0 for the strongest marker of the cluster */
+    double          clusterMean;
+    double          restMean;
+    double          t;                          /** Welch t statistic, NaN when the tables have no variances */
+    double          pValue;                     /** two-sided, NaN when t is */
+    double          clusterNonZeroFraction;     /** NaN when the tables have no non-zero fractions */
+    double          restNonZeroFraction;
+};
+
+/**
+ * Compares every cluster to the rest, i.e. the pooled statistics of all other clusters, in one pass over the
+ * clusters x dimensions tables: the rest of a cluster is the pooled total minus the cluster itself.
+ * The dimensions are ranked per cluster by their Welch t statistic, or by the difference of the means when the tables
+ * have no variances; only the markersPerCluster highest ranked dimensions of every cluster are returned, ordered by
+ * cluster and rank. Clusters with no points, or no points outside them, have no markers.
+ */
+std::vector<OneVsRestMarker> oneVsRestMarkers(const ClusterTables& tables, std::size_t markersPerCluster);
+
+}
@@ -0,0 +1,87 @@
+#include "PairwiseDE.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace cde {
+
+std::vector<float> pairwiseMeanDifferences(const ClusterTables& tables)
+{
+    const std::size_t numClusters = tables.numClusters;
+    const std::size_t numDimensions = tables.numDimensions;
+    const std::ptrdiff_t numPairs = static_cast<std::ptrdiff_t>(numClusters * numClusters);
+    std::vector<float> result(numPairs * numDimensions);
+
+    #pragma omp parallel for schedule(static)
+    for (std::ptrdiff_t pair = 0; pair < numPairs; ++pair)
+    {
+        const float* means1 = tables.means + ((pair / numClusters) * numDimensions);
+        const float* means2 = tables.means + ((pair % numClusters) * numDimensions);
+        float* row = result.data() + (pair * numDimensions);
+        for (std::size_t dimension = 0; dimension < numDimensions; ++dimension)
+            row[dimension] = means1[dimension] - means2[dimension];
+    }
+    return result;
+}
+
+TopPairwiseDifferences topPairwiseMeanDifferences(const ClusterTables& tables, std::size_t k)
+{
+    const std::size_t numClusters = tables.numClusters;
+    const std::size_t numDimensions = tables.numDimensions;
+
+    TopPairwiseDifferences result;
+    result.k = std::min(k, numDimensions);
+    result.values.assign(numClusters * numClusters * result.k, 0);
+    result.dimensions.assign(numClusters * numClusters * result.k, 0);
+    if (result.k == 0)
+        return result;
+
+    const std::ptrdiff_t numPairs = static_cast<std::ptrdiff_t>(numClusters * numClusters);
+
+    #pragma omp parallel
+    {
+        std::vector<float> differences(numDimensions);
+        std::vector<std::uint32_t> order(numDimensions);
+
+        #pragma omp for schedule(dynamic, 1)
+        for (std::ptrdiff_t pair = 0; pair < numPairs; ++pair)
+        {
+            const std::size_t cluster1 = pair / numClusters;
+            const std::size_t cluster2 = pair % numClusters;
+            if (cluster1 > cluster2)
+                continue;   // filled in as the mirror of (cluster2, cluster1)
+
+            const float* means1 = tables.means + (cluster1 * numDimensions);
+            const float* means2 = tables.means + (cluster2 * numDimensions);
+            for (std::size_t dimension = 0; dimension < numDimensions; ++dimension)
+                differences[dimension] = means1[dimension] - means2[dimension];
+
+            // NaN differences, from empty clusters, rank last
+            const auto larger = [&differences](std::uint32_t a, std::uint32_t b)
+            {
+                const float magnitudeA = std::fabs(differences[a]);
+                const float magnitudeB = std::fabs(differences[b]);
+                if (std::isnan(magnitudeB))
+                    return !std::isnan(magnitudeA);
+                return magnitudeA > magnitudeB;
+            };
+            std::iota(order.begin(), order.end(), 0u);
+            std::nth_element(order.begin(), order.begin() + (result.k - 1), order.end(), larger);
+            std::sort(order.begin(), order.begin() + result.k, larger);
+
+            const std::size_t offset = pair * result.k;
+            const std::size_t mirrorOffset = ((cluster2 * numClusters) + cluster1) * result.k;
+            for (std::size_t i = 0; i < result.k; ++i)
+            {
+                result.values[offset + i] = differences[order[i]];
+                result.dimensions[offset + i] = static_cast<float>(order[i]);
+                result.values[mirrorOffset + i] = -differences[order[i]];
+                result.dimensions[mirrorOffset + i] = static_cast<float>(order[i]);
+            }
+        }
+    }
+    return result;
+}
+
+}
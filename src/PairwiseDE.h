@@ -0,0 +1,30 @@
+#pragma once
+
+#include "ClusterStatistics.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace cde {
+
+/**
+ * Differential expression of every ordered pair of clusters as a (numClusters x numClusters) x numDimensions row-major
+ * tensor: row (i * numClusters) + j holds means(i) - means(j), so row (j, i) is the negation of row (i, j).
+ */
+std::vector<float> pairwiseMeanDifferences(const ClusterTables& tables);
+
+/** The k largest differences by magnitude of every ordered pair of clusters, see topPairwiseMeanDifferences */
+struct TopPairwiseDifferences
+{
+    std::size_t         k = 0;
+    std::vector<float>  values;         /** (numClusters x numClusters) x k signed differences, per pair ordered by decreasing magnitude */
+    std::vector<float>  dimensions;     /** dimension index of every value, as float so it can be stored as Points */
+};
+
+/**
+ * Top-k compressed form of pairwiseMeanDifferences, k is clamped to the number of dimensions.
+ * Only the pairs i < j are ranked, the pairs j > i are their negation.
+ */
+TopPairwiseDifferences topPairwiseMeanDifferences(const ClusterTables& tables, std::size_t k);
+
+}
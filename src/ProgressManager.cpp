@@ -17,6 +17,13 @@
 #include "QApplication"
 #include <QLabel>
 #include <QMainWindow>
+#include <QPointer>
+#include <QThread>
+#include <QTimer>
+
+#include <algorithm>
+#include <chrono>
+#include <numeric>
 
 namespace local
 {
@@ -27,6 +34,9 @@ namespace local
                 return mainWindow;
         return nullptr;
     }
+
+    // untracked computations of the calling thread, nested ones included
+    thread_local int untrackedDepth = 0;
 }
 
 ProgressManager::ProgressManager()
@@ -39,17 +49,41 @@ ProgressManager::ProgressManager()
 	, m_autoRaise(true)
 	, m_scaleFactor(0)
 	, m_maxRange(0)
+	, m_postedValue(-1)
+	, m_pollTimer(new QTimer)
+	, m_lastRepaint(0)
+	, m_nextTicket(0)
+	, m_servingTicket(0)
+	, m_taskActive(false)
+	, m_stageOffset(0)
+	, m_stageWeight(0)
 {
-	
+	m_pollTimer->setInterval(POLL_INTERVAL_MS);
+	QObject::connect(m_pollTimer, &QTimer::timeout, m_pollTimer, [this]() { pollProgress(); });
+}
+
+bool ProgressManager::onGuiThread()
+{
+	return qApp && (QThread::currentThread() == qApp->thread());
+}
+
+void ProgressManager::runOnGuiThread(std::function<void()> function)
+{
+	if (onGuiThread())
+		function();
+	else if (qApp)
+		QMetaObject::invokeMethod(qApp, std::move(function), Qt::QueuedConnection);
 }
 
 ProgressManager::~ProgressManager()
 {
+	delete m_pollTimer;
+	m_pollTimer = nullptr;
 	m_cancelled = true;
 	m_available = false;
 	if (m_progressDialog)
 	{
-		while (!m_progressDialog->wasCanceled());
+		m_progressDialog->cancel();
 		delete m_progressDialog;
 		m_progressDialog = nullptr;
 	}
@@ -70,27 +104,82 @@ bool ProgressManager::autoRaise() const
 	return m_autoRaise;
 }
 
-void ProgressManager::start(std::size_t size, const std::string &mesg)
+bool ProgressManager::inOwnTask() const
 {
+	return m_taskActive && (m_taskThread == std::this_thread::get_id());
+}
 
-	while (!m_available);
+bool ProgressManager::acquire(const std::atomic<bool>* cancelled)
+{
+	std::unique_lock<std::mutex> lock(m_queueMutex);
+
+	// the GUI thread may be the one a queued computation waits for, e.g. in QFutureWatcher::waitForFinished, so it never waits itself
+	if (onGuiThread())
+	{
+		if (m_servingTicket != m_nextTicket)
+			return false;
+		++m_nextTicket;
+		m_available = false;
+		m_postedValue = -1;
+		return true;
+	}
 
+	const std::uint64_t ticket = m_nextTicket++;
 	m_available = false;
-	
-	
-	
-	if (m_progressBar)
+	const auto served = [this, ticket]() { return m_servingTicket == ticket; };
+	while (!m_queueChanged.wait_for(lock, std::chrono::milliseconds(POLL_INTERVAL_MS), served))
+	{
+		if (cancelled && *cancelled)
+		{
+			m_abandonedTickets.insert(ticket);
+			return false;
+		}
+	}
+	m_postedValue = -1;
+	return true;
+}
+
+void ProgressManager::release()
+{
 	{
-		
+		std::lock_guard<std::mutex> lock(m_queueMutex);
+		++m_servingTicket;
+		while (m_abandonedTickets.erase(m_servingTicket))
+			++m_servingTicket;
+		m_available = (m_servingTicket == m_nextTicket);
 	}
-	else if (!m_noProgressDialog)
+	m_queueChanged.notify_all();
+}
+
+void ProgressManager::waitUntilIdle()
+{
+	std::unique_lock<std::mutex> lock(m_queueMutex);
+	m_queueChanged.wait(lock, [this]() { return m_servingTicket == m_nextTicket; });
+}
+
+void ProgressManager::beginUntracked()
+{
+	++local::untrackedDepth;
+}
+
+bool ProgressManager::endUntracked()
+{
+	if (local::untrackedDepth == 0)
+		return false;
+	--local::untrackedDepth;
+	return true;
+}
+
+void ProgressManager::showProgress(const QString& label)
+{
+	if (!m_progressBar && !m_noProgressDialog)
 	{
-		if (omp_get_thread_num() == 0)
+		runOnGuiThread([this, label]()
 		{
 			if (m_progressDialog == nullptr)
 				m_progressDialog = new QProgressDialog(local::getMainWindow(), Qt::FramelessWindowHint | Qt::WindowStaysOnTopHint);
 			if (m_cancelled == false)
-				m_progressDialog->setLabelText(mesg.c_str());
+				m_progressDialog->setLabelText(label);
 			m_progressDialog->setWindowModality(Qt::WindowModal);
 			m_progressDialog->setCancelButton(nullptr);
 			m_progressDialog->setMinimumDuration(150);
@@ -99,41 +188,164 @@ void ProgressManager::start(std::size_t size, const std::string &mesg)
 			{
 				m_progressDialog->raise();
 			}
-			
+		});
+	}
+
+	QPointer<QTimer> pollTimer = m_pollTimer;
+	runOnGuiThread([pollTimer]()
+	{
+		if (pollTimer)
+			pollTimer->start();
+	});
+}
+
+void ProgressManager::hideProgress()
+{
+	QPointer<QTimer> pollTimer = m_pollTimer;
+	QPointer<QProgressBar> progressBar = m_progressBar;
+	QPointer<QProgressDialog> progressDialog = m_progressDialog;
+	runOnGuiThread([pollTimer, progressBar, progressDialog]()
+	{
+		if (pollTimer)
+			pollTimer->stop();
+		if (progressBar)
+		{
+			progressBar->setValue(progressBar->maximum());
+		}
+		else if (progressDialog)
+		{
+			progressDialog->cancel();
+			progressDialog->hide();
 		}
+	});
+}
+
+void ProgressManager::beginTask(const QString& name, std::vector<Stage> stages, const std::atomic<bool>* cancelled)
+{
+	if ((local::untrackedDepth > 0) || !acquire(cancelled))
+	{
+		beginUntracked();
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_queueMutex);
+		m_stages = std::move(stages);
 	}
+	m_taskThread = std::this_thread::get_id();
+	m_stageOffset = 0;
+	m_stageWeight = 0;
+	m_maxRange = 0;
+	m_completed.value.store(0, std::memory_order_relaxed);
+	m_taskActive = true;
+
+	showProgress(name);
+	setLabelText(name);
+	setRange(0);
+	repaintProgress();
+}
 
+void ProgressManager::beginStage(std::size_t stage)
+{
+	if (local::untrackedDepth > 0)
+		return;
+	assert(inOwnTask());
+
+	QString stageName;
+	{
+		std::lock_guard<std::mutex> lock(m_queueMutex);
+		assert(stage < m_stages.size());
+
+		const auto addWeight = [](double sum, const Stage& stage) { return sum + stage.weight; };
+		const double totalWeight = std::accumulate(m_stages.cbegin(), m_stages.cend(), 0.0, addWeight);
+		if (totalWeight <= 0)
+			return;
+
+		m_stageOffset = std::accumulate(m_stages.cbegin(), m_stages.cbegin() + stage, 0.0, addWeight) / totalWeight;
+		m_stageWeight = m_stages[stage].weight / totalWeight;
+		stageName = m_stages[stage].name;
+	}
+	m_maxRange = 0;
+	m_completed.value.store(0, std::memory_order_relaxed);
+	setLabelText(stageName);
+}
+
+void ProgressManager::endTask()
+{
+	if (endUntracked())
+		return;
+	assert(inOwnTask());
+	m_taskActive = false;
+	{
+		std::lock_guard<std::mutex> lock(m_queueMutex);
+		m_stages.clear();
+	}
+	release();
+	hideProgress();
+}
+
+void ProgressManager::start(std::size_t size, const std::string &mesg)
+{
+	// within its own task a computation measures the progress of the current stage
+	if (inOwnTask())
+	{
+		setLabelText(mesg.c_str());
+		setRange(size);
+		return;
+	}
+
+	// a computation within an untracked one, or one that cannot show its progress now, runs untracked
+	if ((local::untrackedDepth > 0) || !acquire(nullptr))
+	{
+		beginUntracked();
+		return;
+	}
+	showProgress(mesg.c_str());
 	setLabelText(mesg.c_str());
 	setRange(size);
-	qApp->processEvents();
+	repaintProgress();
 }
 
 void ProgressManager::setRange( std::size_t size)
 {
+	if (local::untrackedDepth > 0)
+		return;
+
 	m_maxRange = size;
 	if (m_maxRange)
 		m_scaleFactor = (1.0f * MAX_RANGE) / m_maxRange;
 	else
 		m_scaleFactor = 0;
-	m_progress.assign(size, 0);
-	if (m_progressBar)
-	{
-		if(size)
-			m_progressBar->setRange(0, MAX_RANGE);
-		else
-			m_progressBar->setRange(0, 0);
-		m_progressBar->setValue(0);
-		m_progressBar->update();
-	}
-	else if (m_progressDialog)
+	m_completed.value.store(0, std::memory_order_relaxed);
+
+	// a task always shows its overall progress, a stage without steps does not turn it into a busy indicator
+	const bool busy = (size == 0) && !m_taskActive;
+	const int progressValue = m_taskActive ? scaledProgress(0) : 0;
+	m_postedValue = progressValue;
+
+	QPointer<QProgressBar> progressBar = m_progressBar;
+	QPointer<QProgressDialog> progressDialog = m_progressDialog;
+	runOnGuiThread([progressBar, progressDialog, busy, progressValue]()
 	{
-		if(size)
-			m_progressDialog->setRange(0, MAX_RANGE);
-		else
-			m_progressDialog->setRange(0, 0);
-		m_progressDialog->setValue(0);
-		m_progressDialog->update();
-	}
+		if (progressBar)
+		{
+			if(!busy)
+				progressBar->setRange(0, MAX_RANGE);
+			else
+				progressBar->setRange(0, 0);
+			progressBar->setValue(progressValue);
+			progressBar->update();
+		}
+		else if (progressDialog)
+		{
+			if(!busy)
+				progressDialog->setRange(0, MAX_RANGE);
+			else
+				progressDialog->setRange(0, 0);
+			progressDialog->setValue(progressValue);
+			progressDialog->update();
+		}
+	});
 }
 
 void ProgressManager::setAutoRaise(bool value)
@@ -146,7 +358,7 @@ void ProgressManager::setProgressBar(QProgressBar *progressBar)
 	
 	if (progressBar == m_progressBar)
 		return;
-	while (!m_available);
+	waitUntilIdle();
 	m_progressBar = progressBar;
 	
 }
@@ -158,112 +370,155 @@ void ProgressManager::setProgressBarLabel(QLabel* label)
 
 void ProgressManager::setNoProgressDialog(bool value)
 {
-	while (!m_available);
+	waitUntilIdle();
 	if (value)
 	{
 		delete  m_progressDialog;
+		m_progressDialog = nullptr;
 	}
 	m_noProgressDialog = value;
 }
 
 void ProgressManager::setValue(std::size_t value)
 {
-	const int progressValue = (value == m_maxRange) ? MAX_RANGE : (m_scaleFactor * value);
+	if (local::untrackedDepth > 0)
+		return;
+	const int progressValue = scaledProgress(value);
+	m_completed.value.store(value, std::memory_order_relaxed);
+	m_postedValue = progressValue;
+	QPointer<QProgressBar> progressBar = m_progressBar;
+	QPointer<QProgressDialog> progressDialog = m_progressDialog;
+	runOnGuiThread([progressBar, progressDialog, progressValue]()
+	{
+		if (progressBar)
+		{
+			progressBar->setValue(progressValue);
+			progressBar->update();
+		}
+		else if (progressDialog)
+		{
+			progressDialog->setValue(progressValue);
+			progressDialog->update();
+		}
+	});
+	repaintProgress();
+}
+
+int ProgressManager::scaledProgress(std::size_t completed) const
+{
+	const std::size_t maxRange = m_maxRange;
+	if (!m_taskActive)
+		return (completed >= maxRange) ? MAX_RANGE : static_cast<int>(m_scaleFactor * completed);
+
+	const double fraction = maxRange ? std::min(1.0, static_cast<double>(completed) / maxRange) : 0.0;
+	return static_cast<int>(MAX_RANGE * (m_stageOffset + (m_stageWeight * fraction)));
+}
+
+void ProgressManager::print(long long i)
+{
+	// the thread that runs an untracked computation does not count its steps, its other OpenMP threads may, the shown progress is clamped
+	if (local::untrackedDepth > 0)
+		return;
+	assert(i >= 0);
+	m_completed.value.fetch_add(1, std::memory_order_relaxed);
+
+	// a computation on the GUI thread keeps the poll timer waiting, it paints its progress itself at the rate of the timer
+	if ((omp_get_thread_num() == 0) && onGuiThread())
+	{
+		const std::int64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		if (now - m_lastRepaint >= POLL_INTERVAL_MS)
+		{
+			m_lastRepaint = now;
+			repaintProgress();
+		}
+	}
+}
+
+void ProgressManager::pollProgress()
+{
+	const int progressValue = scaledProgress(m_completed.value.load(std::memory_order_relaxed));
+	if (m_postedValue.exchange(progressValue) == progressValue)
+		return;
+
 	if (m_progressBar)
 	{
 		m_progressBar->setValue(progressValue);
-		m_progressBar->update();
 	}
 	else if (m_progressDialog)
 	{
 		m_progressDialog->setValue(progressValue);
-		m_progressDialog->update();
+		if (m_autoRaise)
+			m_progressDialog->raise();
 	}
-	qApp->processEvents();
 }
 
-void ProgressManager::print(long long i)
+void ProgressManager::repaintProgress()
 {
-    assert(m_progress[i] == 0);
-    if (m_progress[i] > 0)
-        throw std::out_of_range("ProgressManager - Out Of Range\n");
-	m_progress[i] = 1;
-	if (omp_get_thread_num() == 0)
-	{
-		int64_t zero = 0;
-		int64_t value = std::accumulate(m_progress.cbegin(), m_progress.cend(), zero);
-		const int progressValue = (value == m_maxRange) ? MAX_RANGE : (m_scaleFactor * value);
-
-      
-		if (m_progressBar || m_progressDialog)
-		{
-			
-			if (m_progressBar)
-			{
-				m_progressBar->setValue(progressValue);
-			}
-			else if (m_progressDialog)
-			{
-				m_progressDialog->setValue(progressValue);
-				if (m_autoRaise)
-				{
-					m_progressDialog->update();
-					m_progressDialog->raise();
-				}
-			}
-		}		
+	// no events are processed here, they could run the slots of the computation in progress again
+	if (!onGuiThread())
+		return;
 
-	//	else
-	//		qDebug << "  print:: progressbar&m_progressDialog not set";
+	pollProgress();
+	if (m_progressBar)
+	{
+		m_progressBar->repaint();
+		if (m_progressBarLabel)
+			m_progressBarLabel->repaint();
+	}
+	else if (m_progressDialog && m_progressDialog->isVisible())
+	{
+		m_progressDialog->repaint();
 	}
-	qApp->processEvents();
 }
 
 void ProgressManager::end()
 {
-	m_available = true;
-	
-	if (omp_get_thread_num() == 0)
-	{
-
-	}
+	if (endUntracked())
+		return;
 
-	if (m_progressBar)
-	{
-		m_progressBar->setValue(m_progressBar->maximum());
-	}
-	else if (m_progressDialog)
+	// within its own task the end of a computation only completes the current stage
+	if (inOwnTask())
 	{
-		m_progressDialog->cancel();
-		m_progressDialog->hide();
+		m_completed.value.store(m_maxRange, std::memory_order_relaxed);
+		return;
 	}
-	
+
+	release();
+	hideProgress();
 }
 
 
 
 void ProgressManager::setLabelText(const QString& mesg)
 {
+	if (local::untrackedDepth > 0)
+		return;
 	m_labelText = mesg;
-	if (m_progressBar)
+	QPointer<QProgressBar> progressBar = m_progressBar;
+	QPointer<QLabel> progressBarLabel = m_progressBarLabel;
+	QPointer<QProgressDialog> progressDialog = m_progressDialog;
+	runOnGuiThread([progressBar, progressBarLabel, progressDialog, mesg]()
 	{
-		if (m_progressBarLabel)
+		if (progressBar)
 		{
-			m_progressBarLabel->setText(m_labelText);
-			m_progressBarLabel->update();
+			if (progressBarLabel)
+			{
+				progressBarLabel->setText(mesg);
+				progressBarLabel->update();
+			}
+			else
+			{
+				//m_labelText += " %p%";
+				progressBar->setFormat(mesg);
+				progressBar->update();
+			}
 		}
-		else
+		else if (progressDialog)
 		{
-			//m_labelText += " %p%";
-			m_progressBar->setFormat(m_labelText);
-			m_progressBar->update();
+			progressDialog->setLabelText(mesg);
+			progressDialog->update();
 		}
-	}
-	else if (m_progressDialog)
-	{
-		m_progressDialog->setLabelText(m_labelText);
-		m_progressDialog->update();
-	}
+	});
 }
 
 void ProgressManager::update()
@@ -334,14 +589,7 @@ int ProgressManager::value() const
 
 int  ProgressManager::currentProgress() const
 {
-    if (omp_get_thread_num() == 0)
-    {
-        int64_t zero = 0;
-        int64_t value = std::accumulate(m_progress.cbegin(), m_progress.cend(), zero);
-        const int progressValue = (value == m_maxRange) ? MAX_RANGE : (m_scaleFactor * value);
-        return progressValue;
-    }
-    return 0;
+    return scaledProgress(m_completed.value.load(std::memory_order_relaxed));
 }
 
 bool ProgressManager::canceled() const
@@ -383,3 +631,19 @@ void ProgressManager::setCanceled(bool value)
 		}
 	}
 }
+
+ProgressTask::ProgressTask(ProgressManager& progressManager, const QString& name, std::vector<ProgressManager::Stage> stages, const std::atomic<bool>* cancelled)
+	: m_progressManager(progressManager)
+{
+	m_progressManager.beginTask(name, std::move(stages), cancelled);
+}
+
+ProgressTask::~ProgressTask()
+{
+	m_progressManager.endTask();
+}
+
+void ProgressTask::beginStage(std::size_t stage)
+{
+	m_progressManager.beginStage(stage);
+}
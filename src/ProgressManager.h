@@ -2,6 +2,12 @@
 #pragma once
 
 #include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <thread>
 #include <vector>
 #include <string>
 #include "QSysInfo"
@@ -10,12 +16,37 @@
 class QProgressDialog;
 class QProgressBar;
 class QLabel;
+class QTimer;
 class QWidgetAction;
 
+/**
+ * Shows the progress of one computation at a time on a progress bar or dialog. Computations on worker threads queue up: a
+ * start() or beginTask() blocks, in order of arrival, until the computations before it have ended or the computation is cancelled.
+ * The GUI thread never waits for the queue, its computations run untracked while another one shows its progress.
+ * A task groups the computations of a larger job into weighted stages, so the bar shows the progress of the whole job;
+ * the start()/end() calls of the thread that began the task then measure the progress within the current stage.
+ */
 class ProgressManager
 {
+public:
+	struct Stage
+	{
+		QString	name;
+		double	weight;		/** relative share of the work of the task */
+	};
+
+private:
 	enum{MAX_RANGE=1000};
-	std::vector<int8_t> m_progress;
+	enum{POLL_INTERVAL_MS=33};	// the GUI thread shows the progress of the workers at about 30 Hz
+
+	// completed steps, on a cache line of its own as every worker thread increments it
+	struct alignas(64) Counter
+	{
+		std::atomic<std::size_t> value{ 0 };
+	};
+	Counter m_completed;
+	QTimer* m_pollTimer;
+	std::int64_t m_lastRepaint;
 	QString m_labelText;
 	QProgressDialog *m_progressDialog;
 	std::atomic<bool> m_available;
@@ -24,8 +55,52 @@ class ProgressManager
 	std::atomic<bool> m_cancelled;
 	bool m_noProgressDialog;
 	bool m_autoRaise;
-	float m_scaleFactor;
-	std::size_t m_maxRange;
+	std::atomic<float> m_scaleFactor;	// written by the computation, read by the poll timer
+	std::atomic<std::size_t> m_maxRange;
+	std::atomic<int> m_postedValue;
+
+	// tickets of the computations in order of arrival, the computation holding m_servingTicket shows its progress
+	std::mutex m_queueMutex;
+	std::condition_variable m_queueChanged;
+	std::uint64_t m_nextTicket;
+	std::uint64_t m_servingTicket;
+	std::set<std::uint64_t> m_abandonedTickets;	// tickets of cancelled computations that stopped waiting, skipped when served
+
+	// stages of the current task, guarded by m_queueMutex; the offset and weight of the current stage are fractions of the whole task
+	std::vector<Stage> m_stages;
+	std::thread::id m_taskThread;
+	std::atomic<bool> m_taskActive;
+	std::atomic<double> m_stageOffset;
+	std::atomic<double> m_stageWeight;
+
+	// widgets may only be touched from the GUI thread, calls from worker threads are queued to it
+	static bool onGuiThread();
+	void runOnGuiThread(std::function<void()> function);
+
+	bool inOwnTask() const;
+
+	/**
+	 * Blocks until the computations queued before this one have ended, returns false when cancelled meanwhile.
+	 * On the GUI thread it never blocks and returns false when another computation shows its progress.
+	 */
+	bool acquire(const std::atomic<bool>* cancelled);
+	void release();
+	void waitUntilIdle();
+
+	/** Counts the untracked computation of the calling thread, its end() or endTask() then only uncounts it */
+	void beginUntracked();
+	bool endUntracked();
+
+	void showProgress(const QString& label);
+	void hideProgress();
+
+	int scaledProgress(std::size_t completed) const;
+
+	/** Shows the completed steps on the progress bar or dialog, only called on the GUI thread by m_pollTimer and repaintProgress */
+	void pollProgress();
+
+	/** Paints the progress of a computation on the GUI thread right away, as it keeps the poll timer and the event loop waiting */
+	void repaintProgress();
 public:
 	ProgressManager();
 	~ProgressManager();
@@ -33,6 +108,15 @@ public:
 	bool autoRaise() const;
 	bool canceled() const;
 	void setCanceled(bool value);
+
+	/**
+	 * Queues a task of named stages, the stages are entered in any order with beginStage and skipped stages count as done.
+	 * A task that is cancelled while queued, or that begins on the GUI thread while another computation shows its progress, runs untracked.
+	 */
+	void beginTask(const QString& name, std::vector<Stage> stages, const std::atomic<bool>* cancelled = nullptr);
+	void beginStage(std::size_t stage);
+	void endTask();
+
 	void start(std::size_t, const std::string &mesg);
 	void setRange(std::size_t size);
 	void setAutoRaise(bool value);
@@ -40,6 +124,7 @@ public:
 	void setProgressBarLabel(QLabel* label);
 	void setNoProgressDialog(bool value);
 	void setValue(std::size_t value);
+	/** Marks step i as completed, can be called from any thread and never touches a widget */
 	void print(long long i);
 	void end();
 	void setLabelText(const QString& mesg);
@@ -54,3 +139,19 @@ public:
 	
 
 };
+
+/** Ends the task it began when it goes out of scope, also on the early returns of a cancelled computation */
+class ProgressTask
+{
+public:
+	ProgressTask(ProgressManager& progressManager, const QString& name, std::vector<ProgressManager::Stage> stages, const std::atomic<bool>* cancelled = nullptr);
+	~ProgressTask();
+
+	ProgressTask(const ProgressTask&) = delete;
+	ProgressTask& operator=(const ProgressTask&) = delete;
+
+	void beginStage(std::size_t stage);
+
+private:
+	ProgressManager& m_progressManager;
+};
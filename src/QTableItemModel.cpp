@@ -2,6 +2,9 @@
 #include <QApplication>
 #include <QClipboard>
 #include <assert.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
 #include <QMetaType>
 #include <QLabel>
 #include <QAbstractItemModelTester>
@@ -11,6 +14,36 @@ namespace
 {
 	namespace local
 	{
+		/** The types a Column stores as doubles; 64-bit integers only while they convert exactly */
+		bool isNumberType(int type)
+		{
+			switch (type)
+			{
+			case QMetaType::Float:
+			case QMetaType::Double:
+			case QMetaType::Int:
+			case QMetaType::UInt:
+			case QMetaType::LongLong:
+			case QMetaType::ULongLong:
+				return true;
+			default:
+				return false;
+			}
+		}
+
+		bool isExactNumber(const QVariant& value, double number)
+		{
+			switch (value.metaType().id())
+			{
+			case QMetaType::LongLong:
+				return (std::fabs(number) < 0x1p63) && (static_cast<qlonglong>(number) == value.toLongLong());
+			case QMetaType::ULongLong:
+				return (number < 0x1p64) && (static_cast<qulonglong>(number) == value.toULongLong());
+			default:
+				return true;
+			}
+		}
+
 		void fixQStringForClipboard(QString& s, QChar separator)
 		{
 			QChar defaultReplaceChar = ' ';
@@ -23,8 +56,110 @@ namespace
 	}
 }
 
+QVariant QTableItemModel::Column::value(std::size_t row) const
+{
+	if (!m_styledCells.isEmpty())
+	{
+		auto found = m_styledCells.constFind(row);
+		if (found != m_styledCells.constEnd())
+			return found.value();
+	}
+	if (!m_strings.empty() && !m_strings[row].isNull())
+		return m_strings[row];
+	if (!m_numbers.empty() && !std::isnan(m_numbers[row]))
+	{
+		if (m_numberType == QMetaType::Float)
+			return static_cast<float>(m_numbers[row]);
+		if (m_numberType == QMetaType::Double)
+			return m_numbers[row];
+		QVariant number(m_numbers[row]);
+		number.convert(QMetaType(m_numberType));
+		return number;
+	}
+	return QVariant();
+}
+
+void QTableItemModel::Column::setValue(std::size_t row, const QVariant& value)
+{
+	assert(row < m_rows);
+	if (!m_numbers.empty())
+		m_numbers[row] = std::numeric_limits<double>::quiet_NaN();
+	if (!m_strings.empty())
+		m_strings[row] = QString();
+	m_styledCells.remove(row);
+
+	const int type = value.metaType().id();
+	if (local::isNumberType(type))
+	{
+		// a column reports all its numbers as the type of its first one, numbers of other types are kept as they are
+		if (m_numberType == QMetaType::UnknownType)
+			m_numberType = type;
+		const double number = value.toDouble();
+		if ((type == m_numberType) && !std::isnan(number) && local::isExactNumber(value, number))
+		{
+			if (m_numbers.empty())
+				m_numbers.assign(m_rows, std::numeric_limits<double>::quiet_NaN());
+			m_numbers[row] = number;
+			return;
+		}
+	}
+	else if (type == QMetaType::QString)
+	{
+		QString string = value.toString();
+		if (!string.isNull())
+		{
+			if (m_strings.empty())
+				m_strings.resize(m_rows);
+			m_strings[row] = std::move(string);
+			return;
+		}
+	}
+	else if (!value.isValid())
+	{
+		return;
+	}
+	m_styledCells.insert(row, value);
+}
+
+void QTableItemModel::Column::resize(std::size_t rows)
+{
+	m_rows = rows;
+	if (!m_numbers.empty())
+		m_numbers.resize(rows, std::numeric_limits<double>::quiet_NaN());
+	if (!m_strings.empty())
+		m_strings.resize(rows);
+	m_styledCells.removeIf([rows](QHash<std::size_t, QVariant>::iterator cell) { return cell.key() >= rows; });
+}
+
+std::size_t QTableItemModel::Column::memoryUsage() const
+{
+	// a rough estimate of a QVariantMap cell with a few roles
+	constexpr std::size_t STYLED_CELL_BYTES = 256;
+
+	std::size_t bytes = (m_numbers.capacity() * sizeof(double)) + (m_strings.capacity() * sizeof(QString));
+	for (const QString& string : m_strings)
+		bytes += string.capacity() * sizeof(QChar);
+	return bytes + (m_styledCells.size() * STYLED_CELL_BYTES);
+}
+
+double QTableItemModel::Column::number(std::size_t row) const
+{
+	if (m_numbers.empty())
+		return std::numeric_limits<double>::quiet_NaN();
+	return m_numbers[row];
+}
+
+const QString& QTableItemModel::Column::string(std::size_t row) const
+{
+	static const QString empty;
+	if (m_strings.empty())
+		return empty;
+	return m_strings[row];
+}
+
 QTableItemModel::QTableItemModel(QObject *parent /*= Q_NULLPTR*/, bool checkable)
 	:QAbstractTableModel(parent)
+	, m_rows(0)
 	, m_checkable(checkable)
 	, m_columns(0)
 	, m_status(Status::Undefined)
@@ -36,7 +171,7 @@ QTableItemModel::QTableItemModel(QObject *parent /*= Q_NULLPTR*/, bool checkable
 int QTableItemModel::rowCount(const QModelIndex &parent /*= QModelIndex()*/) const
 {
 	Q_UNUSED(parent);
-	return m_data.size();
+	return m_rows;
 }
 
 int QTableItemModel::columnCount(const QModelIndex &parent /*= QModelIndex()*/) const
@@ -57,12 +192,17 @@ QVariant QTableItemModel::data(const QModelIndex &index, int role /*= Qt::Displa
 	int c = index.column();
 	if (!index.isValid())
 		return QVariant();
-	if (index.row() >= m_data.size() || index.row() < 0)
+	if (index.row() >= m_rows || index.row() < 0)
 		return QVariant();
 	if (index.column() >= columnCount() || index.column() < 0)
 		return QVariant();
+#ifdef TESTING
+	if (index.column() == m_columns)
+		return r;
+#endif
 
-	auto data = m_data[index.row()].data[index.column()];
+	// the cell is only turned into a QVariant here, when it is displayed
+	auto data = m_data[index.column()].value(index.row());
 	
 	if(data.metaType().id() == QMetaType::QVariantMap/*QMetaType::fromType<QVariantMap>().id()*/)
 	{
@@ -84,7 +224,7 @@ QVariant QTableItemModel::data(const QModelIndex &index, int role /*= Qt::Displa
 	}
 	else if  (m_checkable && (role == Qt::CheckStateRole && index.column() == 0))
 	{
-		return m_data[index.row()].checkState();
+		return m_checkStates[index.row()];
 	}
 
 	return QVariant();
@@ -95,16 +235,16 @@ bool QTableItemModel::setData(const QModelIndex & index, const QVariant & value,
 	if (m_checkable &&( role == Qt::CheckStateRole && index.column() == 0))
 	{
 		Qt::CheckState state = static_cast<Qt::CheckState>(value.toUInt());
-		if (m_data[index.row()].checkState() != state)
+		if (m_checkStates[index.row()] != state)
 		{
-			m_data[index.row()].setCheckState(state);
+			m_checkStates[index.row()] = state;
 			emit dataChanged(index, index, {Qt::CheckStateRole});
 			return true;
 		}
 	}
 	else if (role == Qt::EditRole)
 	{
-		m_data[index.row()].data[index.column()] = value;
+		m_data[index.column()].setValue(index.row(), value);
 		emit dataChanged(index, index, {Qt::EditRole});
 		return true;
 	}
@@ -133,7 +273,7 @@ void QTableItemModel::resize(std::size_t rows, std::size_t columns)
 		layoutToBeChanged = true;
 	}
 	
-	if (rows != m_data.size())
+	if (rows != m_rows)
 	{
 		
 		layoutToBeChanged = true;
@@ -142,25 +282,24 @@ void QTableItemModel::resize(std::size_t rows, std::size_t columns)
 	if(layoutToBeChanged)
 	{
 		layoutAboutToBeChanged();
-		m_data.resize(rows);
-		for (std::size_t i = 0; i < rows; ++i)
-		{
-#ifdef TESTING
-			m_data[i].data.resize(m_columns + 1);
-			m_data[i].data[m_columns] = i;
-#endif
-			if (m_data[i].data.size() != m_columns)
-				m_data[i].data.resize(m_columns);
-
-		}
+		m_rows = rows;
+		m_data.resize(m_columns);
+		for (auto& column : m_data)
+			column.resize(m_rows);
+		m_checkStates.resize(m_rows, Qt::Unchecked);
 		emit layoutChanged();
 	}
 	
 }
 
-QVariant& QTableItemModel::at(std::size_t row, std::size_t column)
+QVariant QTableItemModel::at(std::size_t row, std::size_t column) const
 {
-	return m_data[row].data[column];
+	return m_data[column].value(row);
+}
+
+const QTableItemModel::Column& QTableItemModel::column(std::size_t column) const
+{
+	return m_data[column];
 }
 
 
@@ -172,23 +311,23 @@ void QTableItemModel::setRow(std::size_t row, const std::vector<QVariant> &data,
 	std::size_t startColumn = m_columns;
 	std::size_t endColumn = m_columns;
 	
-	if (m_checkable && (checked != m_data[row].checkState()))
+	if (m_checkable && (checked != m_checkStates[row]))
 	{
 		startColumn = 0;
 		endColumn = 0;
-		m_data[row].setCheckState(checked);
+		m_checkStates[row] = checked;
 	}
 	
 	for (std::size_t column = 0; column < m_columns; ++column)
 	{
-		if (m_data[row].data[column] != data[column])
+		if (m_data[column].value(row) != data[column])
 		{
 			if (startColumn == m_columns)
 			{
 				startColumn = column;
 			}
 			endColumn = column;
-			m_data[row].data[column] = data[column];
+			m_data[column].setValue(row, data[column]);
 		}
 	}
 	
@@ -203,6 +342,28 @@ void QTableItemModel::setRow(std::size_t row, const std::vector<QVariant> &data,
 	}
 }
 
+void QTableItemModel::setRows(std::vector<std::vector<QVariant>>&& rows, Qt::CheckState checked)
+{
+	assert(rows.size() == m_rows);
+	const std::ptrdiff_t count = static_cast<std::ptrdiff_t>(std::min(rows.size(), m_rows));
+	const std::ptrdiff_t columns = static_cast<std::ptrdiff_t>(m_columns);
+
+	// every column is filled by one thread, front to back
+	#pragma omp parallel for schedule(dynamic, 1)
+	for (std::ptrdiff_t column = 0; column < columns; ++column)
+	{
+		m_data[column] = Column();
+		m_data[column].resize(m_rows);
+		for (std::ptrdiff_t row = 0; row < count; ++row)
+		{
+			assert(rows[row].size() == m_columns);
+			m_data[column].setValue(row, rows[row][column]);
+		}
+	}
+	std::fill_n(m_checkStates.begin(), count, checked);
+	rows.clear();
+}
+
 QVariant QTableItemModel::headerData(int section, Qt::Orientation orientation, int role) const 
 {
 	if (section >= 0 && section < m_horizontalHeader.size())
@@ -223,17 +384,26 @@ void QTableItemModel::setCheckState(int row, Qt::CheckState state)
 
 Qt::CheckState QTableItemModel::checkState(int row) const
 {
-	return m_data[row].checkState();
+	return m_checkStates[row];
 }
 
 void QTableItemModel::clear()
 {
 	m_data.clear();
+	m_checkStates.clear();
+	m_rows = 0;
 }
 
-void QTableItemModel::startModelBuilding(qsizetype columns, qsizetype rows)
+void QTableItemModel::startModelBuilding(qsizetype columns, qsizetype rows, std::vector<Column>* previousColumns)
 {
 	beginResetModel();
+	if (previousColumns)
+	{
+		*previousColumns = std::move(m_data);
+		m_data.assign(m_columns, Column());
+		for (auto& column : m_data)
+			column.resize(m_rows);
+	}
 	resize(rows, columns);
 
 	if(m_headerStatus != Status::UpToDate)
@@ -258,6 +428,14 @@ void QTableItemModel::startModelBuilding(qsizetype columns, qsizetype rows)
 	setStatus(Status::Updating);
 }
 
+void QTableItemModel::swapColumns(std::vector<Column>& columns, Qt::CheckState checked)
+{
+	assert(columns.size() == m_columns);
+	assert(std::all_of(columns.cbegin(), columns.cend(), [this](const Column& column) { return column.size() == m_rows; }));
+	std::swap(m_data, columns);
+	std::fill(m_checkStates.begin(), m_checkStates.end(), checked);
+}
+
 void QTableItemModel::endModelBuilding()
 {
 	setStatus(Status::UpToDate);
@@ -267,7 +445,7 @@ void QTableItemModel::endModelBuilding()
 		m_headerStatus = Status::UpToDate;
 	}
 	endResetModel();
-	emit dataChanged(index(0, 0), index(m_data.size(), m_columns));
+	emit dataChanged(index(0, 0), index(m_rows, m_columns));
 }
 
 QVariant QTableItemModel::getHorizontalHeader(int index) const
@@ -355,7 +533,7 @@ QString QTableItemModel::createCSVString(const QChar separatorChar) const
 	}
 	result += "\n";
 
-	const std::size_t rows = m_data.size();
+	const std::size_t rows = m_rows;
 	for (std::size_t r = 0; r < rows; ++r)
 	{
 		for (std::size_t c = 0; c < m_columns; ++c)
@@ -370,11 +548,11 @@ QString QTableItemModel::createCSVString(const QChar separatorChar) const
 			{
 				if (c != 0)
 					result += separatorChar;
-				QVariant variant = m_data[r].data[c];
+				QVariant variant = m_data[c].value(r);
 				
 				if (variant.canConvert<QString>())
 				{
-					QString text = m_data[r].data[c].toString();
+					QString text = variant.toString();
 					local::fixQStringForClipboard(text, separatorChar);
 					result += text;
 				}
@@ -2,6 +2,7 @@
 #ifndef QTableItemModel_H
 #define QTableItemModel_H
 #include "QAbstractItemModel"
+#include <QHash>
 #include <vector>
 
 #include "QStandardItemModel"
@@ -14,15 +15,34 @@ class QTableItemModel : public QAbstractTableModel
 public:
 	enum class Status { Undefined, OutDated, Updating, UpToDate };
 
-	class Row
+	/**
+	 * The cells of a column, stored by type: numbers in a contiguous array, strings in a string array and everything else,
+	 * such as the QVariantMap cells of the info columns, in a sparse side table. The arrays are only allocated for the
+	 * types the column holds; a cell is empty when it is in none of them.
+	 */
+	class Column
 	{
 	public:
-		std::vector<QVariant> data;
-		Qt::CheckState checkState() const{ return m_checkState; }
-		void setCheckState(Qt::CheckState &c){ m_checkState = c; }
+		QVariant value(std::size_t row) const;
+		void setValue(std::size_t row, const QVariant& value);
+		void resize(std::size_t rows);
+		std::size_t size() const { return m_rows; }
+
+		/** Approximate number of bytes the cells take, strings shared with other cells are counted for every cell */
+		std::size_t memoryUsage() const;
+
+		/** Returns the cell as a number, or NaN when it is not a number */
+		double number(std::size_t row) const;
+
+		/** Returns the cell if it is a string stored in the string array, an empty string otherwise */
+		const QString& string(std::size_t row) const;
+
 	private:
-		Qt::CheckState m_checkState;
-		
+		std::size_t						m_rows = 0;
+		int								m_numberType = QMetaType::UnknownType;	/** Float or Double, the type the numbers are reported as */
+		std::vector<double>				m_numbers;		/** NaN where the cell is not a number */
+		std::vector<QString>			m_strings;		/** null where the cell is not a string */
+		QHash<std::size_t, QVariant>	m_styledCells;	/** all other cells, by row */
 	};
 	Q_OBJECT
 
@@ -44,12 +64,26 @@ public:
 	Qt::CheckState checkState(int row) const;
 
 	
-	QVariant& at(std::size_t row, std::size_t column);
+	QVariant at(std::size_t row, std::size_t column) const;
+	const Column& column(std::size_t column) const;
 	
 	void setRow(std::size_t row, const std::vector<QVariant> &data, Qt::CheckState checked, bool silent=false);
 
+	/**
+	 * Moves complete rows into the model, only to be used between startModelBuilding and endModelBuilding.
+	 * Unlike setRow the cells are not compared to the current ones, the model is reset anyway.
+	 */
+	void setRows(std::vector<std::vector<QVariant>>&& rows, Qt::CheckState checked);
+
 	
-	void startModelBuilding(qsizetype columns, qsizetype rows);
+	/** When previousColumns is given, the cells of the current table are moved into it instead of being resized */
+	void startModelBuilding(qsizetype columns, qsizetype rows, std::vector<Column>* previousColumns = nullptr);
+
+	/**
+	 * Exchanges the cells of all columns with the given ones in constant time, only to be used between startModelBuilding
+	 * and endModelBuilding. The given columns must have the numbers of columns and rows the model was started with.
+	 */
+	void swapColumns(std::vector<Column>& columns, Qt::CheckState checked);
 
 	void endModelBuilding();
 	QVariant getHorizontalHeader(int index) const;
@@ -74,7 +108,9 @@ signals:
 
 private:
 	
-	std::vector < Row > m_data;
+	std::vector < Column > m_data;
+	std::vector < Qt::CheckState > m_checkStates;
+	std::size_t m_rows;
 	std::vector < QVariant> m_horizontalHeader;
 	//std::vector < QWidget*> m_horizontalHeaderWidgets;
 	bool m_checkable;
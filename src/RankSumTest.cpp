@@ -0,0 +1,109 @@
+#include "RankSumTest.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace cde {
+
+namespace {
+    // memory budget of one gathered column block, large enough to keep all threads busy with a few hundred dimensions
+    constexpr std::size_t RANK_BLOCK_BUDGET = 256 * 1024 * 1024;
+
+    /**
+     * Moves the NaN values to the back and leaves them out, as they have no rank. Moves the non-zero values to the front
+     * and sorts them. Returns the number of values that are not NaN and sets nonZeros to the number of non-zero values.
+     */
+    std::size_t sortNonZeros(float* values, std::size_t count, std::size_t& nonZeros)
+    {
+        float* valuesEnd = std::partition(values, values + count, [](float value) { return !std::isnan(value); });
+        float* nonZerosEnd = std::partition(values, valuesEnd, [](float value) { return value != 0.0f; });
+        std::sort(values, nonZerosEnd);
+        nonZeros = static_cast<std::size_t>(nonZerosEnd - values);
+        return static_cast<std::size_t>(valuesEnd - values);
+    }
+}
+
+std::size_t resolveRankBlockSize(std::size_t numRows, std::size_t numDimensions, std::size_t requestedBlockSize)
+{
+    std::size_t blockSize = requestedBlockSize;
+    if (blockSize == 0)
+        blockSize = RANK_BLOCK_BUDGET / (std::max<std::size_t>(numRows, 1) * sizeof(float));
+    return std::max<std::size_t>(1, std::min(blockSize, numDimensions));
+}
+
+RankSumResult rankSumTest(float* group1, std::size_t count1, float* group2, std::size_t count2)
+{
+    const double NaN = std::numeric_limits<double>::quiet_NaN();
+    std::size_t nonZeros1 = 0;
+    std::size_t nonZeros2 = 0;
+    count1 = sortNonZeros(group1, count1, nonZeros1);
+    count2 = sortNonZeros(group2, count2, nonZeros2);
+    if (count1 == 0 || count2 == 0)
+        return { NaN, NaN, NaN };
+
+    const std::size_t zeros = (count1 - nonZeros1) + (count2 - nonZeros2);
+
+    // walk both sorted groups in tie blocks, the zeros go in as one block between the negative and the positive values
+    double rankSum1 = 0;
+    double tieCorrection = 0;   // sum of t^3 - t over all tie blocks
+    double ranked = 0;
+    bool zerosRanked = (zeros == 0);
+
+    const auto addTieBlock = [&rankSum1, &tieCorrection, &ranked](double tiesInGroup1, double ties)
+    {
+        rankSum1 += tiesInGroup1 * (ranked + ((ties + 1) / 2));
+        tieCorrection += (ties * ties * ties) - ties;
+        ranked += ties;
+    };
+
+    std::size_t i = 0;
+    std::size_t j = 0;
+    while ((i < nonZeros1) || (j < nonZeros2))
+    {
+        const float value = (j == nonZeros2 || ((i < nonZeros1) && (group1[i] < group2[j]))) ? group1[i] : group2[j];
+        if (!zerosRanked && value > 0.0f)
+        {
+            addTieBlock(static_cast<double>(count1 - nonZeros1), static_cast<double>(zeros));
+            zerosRanked = true;
+        }
+
+        const std::size_t first1 = i;
+        const std::size_t first2 = j;
+        while (i < nonZeros1 && group1[i] == value)
+            ++i;
+        while (j < nonZeros2 && group2[j] == value)
+            ++j;
+
+        // every value equals itself once the NaN values are left out, this only guards against a walk that cannot advance
+        if ((i == first1) && (j == first2))
+            return { NaN, NaN, NaN };
+        addTieBlock(static_cast<double>(i - first1), static_cast<double>((i - first1) + (j - first2)));
+    }
+    if (!zerosRanked)
+        addTieBlock(static_cast<double>(count1 - nonZeros1), static_cast<double>(zeros));
+
+    const double n1 = static_cast<double>(count1);
+    const double n2 = static_cast<double>(count2);
+    const double n = n1 + n2;
+
+    RankSumResult result;
+    result.U = rankSum1 - (n1 * (n1 + 1) / 2);
+    result.auroc = result.U / (n1 * n2);
+
+    const double variance = (n1 * n2 / 12) * ((n + 1) - (tieCorrection / (n * (n - 1))));
+    if (variance > 0)
+    {
+        const double deviation = result.U - (n1 * n2 / 2);
+        const double z = std::max(0.0, std::fabs(deviation) - 0.5) / std::sqrt(variance);
+        result.pValue = std::min(1.0, std::erfc(z / std::sqrt(2.0)));
+    }
+    else
+    {
+        // all values are tied
+        result.pValue = NaN;
+    }
+    return result;
+}
+
+}
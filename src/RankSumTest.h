@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace cde {
+
+struct RankSumResult
+{
+    double U;                   /** Mann-Whitney U of the first group */
+    double auroc;               /** U / (n1 * n2), the probability that a value of the first group ranks above one of the second */
+    double pValue;              /** two-sided, normal approximation with tie and continuity correction */
+};
+
+/**
+ * Wilcoxon rank-sum (Mann-Whitney U) test of two groups of values.
+ * Ties get their average rank. Zeros, the bulk of the values in expression data, are counted instead of sorted
+ * and ranked as a single tie block, so only the non-zero values of both groups are sorted.
+ * NaN values are missing values and left out; the result is NaN when a group has no other values.
+ * Both groups are reordered in place.
+ */
+RankSumResult rankSumTest(float* group1, std::size_t count1, float* group2, std::size_t count2);
+
+/** Number of dimensions per column block such that the gathered values of numRows rows stay within the memory budget */
+std::size_t resolveRankBlockSize(std::size_t numRows, std::size_t numDimensions, std::size_t requestedBlockSize);
+
+/**
+ * Gathers a block of columns of the points into a column-major buffer, so every dimension can be ranked on its own.
+ *
+ * @param vec Point view as handed out by Points::visitData
+ * @param rows Point indices to gather, the value of rows[r] in dimensions[c] ends up at columns[c * rows.size() + r]
+ * @param dimensions Dimension indices of the block, negative indices (dimensions missing from the points) are skipped
+ * @param columns Output buffer, resized by this function
+ */
+template<typename PointView>
+void gatherColumnBlock(const PointView& vec, const std::vector<std::uint32_t>& rows, const std::vector<std::ptrdiff_t>& dimensions, std::vector<float>& columns)
+{
+    const std::size_t numRows = rows.size();
+    const std::ptrdiff_t numColumns = static_cast<std::ptrdiff_t>(dimensions.size());
+    columns.resize(numRows * dimensions.size());
+
+    #pragma omp parallel for schedule(static)
+    for (std::ptrdiff_t r = 0; r < static_cast<std::ptrdiff_t>(numRows); ++r)
+    {
+        const auto point = vec[rows[r]];
+        for (std::ptrdiff_t c = 0; c < numColumns; ++c)
+        {
+            if (dimensions[c] >= 0)
+                columns[(c * numRows) + r] = static_cast<float>(point[dimensions[c]]);
+        }
+    }
+}
+
+/** Same as gatherColumnBlock for a contiguous row-major array with numDimensions values per row */
+template<typename T>
+void gatherContiguousColumnBlock(const T* data, std::size_t numDimensions, const std::vector<std::uint32_t>& rows, const std::vector<std::ptrdiff_t>& dimensions, std::vector<float>& columns)
+{
+    const std::size_t numRows = rows.size();
+    const std::ptrdiff_t numColumns = static_cast<std::ptrdiff_t>(dimensions.size());
+    columns.resize(numRows * dimensions.size());
+
+    #pragma omp parallel for schedule(static)
+    for (std::ptrdiff_t r = 0; r < static_cast<std::ptrdiff_t>(numRows); ++r)
+    {
+        const T* row = data + (static_cast<std::size_t>(rows[r]) * numDimensions);
+        for (std::ptrdiff_t c = 0; c < numColumns; ++c)
+        {
+            if (dimensions[c] >= 0)
+                columns[(c * numRows) + r] = static_cast<float>(row[dimensions[c]]);
+        }
+    }
+}
+
+}
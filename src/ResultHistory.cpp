@@ -0,0 +1,75 @@
+#include "ResultHistory.h"
+
+#include <algorithm>
+
+namespace cde {
+
+bool ResultTable::matches(const QByteArray& selectionKey, const std::vector<std::shared_ptr<const void>>& currentSources) const
+{
+    if (key.isEmpty() || (key != selectionKey) || (sources.size() != currentSources.size()))
+        return false;
+
+    // a locked weak_ptr is still the same object, an expired one never compares equal to a replacement at its address
+    for (std::size_t i = 0; i < sources.size(); ++i)
+    {
+        if (!currentSources[i] || (sources[i].lock() != currentSources[i]))
+            return false;
+    }
+    return true;
+}
+
+void ResultHistory::setMaximumMemory(std::size_t bytes)
+{
+    _maximumMemory = bytes;
+    evict();
+}
+
+bool ResultHistory::take(const QByteArray& key, const std::vector<std::shared_ptr<const void>>& sources, ResultTable& table)
+{
+    auto found = std::find_if(_entries.begin(), _entries.end(), [&key](const ResultTable& entry) { return entry.key == key; });
+    if (found == _entries.end())
+        return false;
+
+    const bool valid = found->matches(key, sources);
+    if (valid)
+        table = std::move(*found);
+    _memoryUsage -= found->memoryUsage;
+    _entries.erase(found);
+    return valid;
+}
+
+void ResultHistory::insert(ResultTable&& table)
+{
+    auto found = std::find_if(_entries.begin(), _entries.end(), [&table](const ResultTable& entry) { return entry.key == table.key; });
+    if (found != _entries.end())
+    {
+        _memoryUsage -= found->memoryUsage;
+        _entries.erase(found);
+    }
+
+    table.memoryUsage = table.rowDimensions.capacity() * sizeof(qsizetype);
+    for (const auto& column : table.columns)
+        table.memoryUsage += column.memoryUsage();
+    if (table.key.isEmpty() || (table.memoryUsage > _maximumMemory))
+        return;
+
+    _memoryUsage += table.memoryUsage;
+    _entries.push_back(std::move(table));
+    evict();
+}
+
+void ResultHistory::clear()
+{
+    _entries.clear();
+    _memoryUsage = 0;
+}
+
+void ResultHistory::evict()
+{
+    std::size_t count = 0;
+    while ((count < _entries.size()) && (_memoryUsage > _maximumMemory))
+        _memoryUsage -= _entries[count++].memoryUsage;
+    _entries.erase(_entries.begin(), _entries.begin() + count);
+}
+
+}
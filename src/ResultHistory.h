@@ -0,0 +1,59 @@
+#pragma once
+
+#include "DimensionMatching.h"
+#include "QTableItemModel.h"
+
+#include <QByteArray>
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace cde {
+
+/** The cells of a computed DE table together with the inputs it was computed for */
+struct ResultTable
+{
+    QByteArray                                      key;                /** signature of the selection the table was computed for */
+    std::vector<std::weak_ptr<const void>>          sources;            /** the DE_Statistics the table was computed from, the version of the table */
+    std::vector<QTableItemModel::Column>            columns;
+    std::vector<qsizetype>                          rowDimensions;      /** matched dimension of every row, empty when every dimension has a row */
+    std::shared_ptr<const DimensionMatching>        dimensionMatching;
+    std::size_t                                     memoryUsage = 0;
+
+    /** The table was computed for this selection and all its sources are still the given ones */
+    bool matches(const QByteArray& selectionKey, const std::vector<std::shared_ptr<const void>>& currentSources) const;
+};
+
+/**
+ * The most recently shown DE tables, so switching back to a recent selection swaps its cells into the model instead of
+ * computing them again. Tables are moved in and out, never copied. The least recently used tables are removed once the
+ * tables take more than the maximum memory.
+ */
+class ResultHistory
+{
+public:
+    /** Maximum memory of all tables in bytes, 0 disables the history */
+    void setMaximumMemory(std::size_t bytes);
+    std::size_t maximumMemory() const { return _maximumMemory; }
+
+    /** Moves the table of the selection out of the history, returns false when there is none or it is stale */
+    bool take(const QByteArray& key, const std::vector<std::shared_ptr<const void>>& sources, ResultTable& table);
+
+    /** Adds the table as the most recently used one, it is dropped when it alone takes more than the maximum memory */
+    void insert(ResultTable&& table);
+
+    void clear();
+
+    std::size_t size() const { return _entries.size(); }
+    std::size_t memoryUsage() const { return _memoryUsage; }
+
+private:
+    void evict();
+
+    std::size_t                 _maximumMemory = 0;
+    std::size_t                 _memoryUsage = 0;
+    std::vector<ResultTable>    _entries;   /** most recently used last */
+};
+
+}
@@ -0,0 +1,256 @@
+#include "RowKernels.h"
+
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define CDE_X86_KERNELS 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define CDE_TARGET(instructionSet)
+#else
+#define CDE_TARGET(instructionSet) __attribute__((target(instructionSet)))
+#endif
+#endif
+
+namespace cde {
+
+namespace {
+
+    template<ElementType E> struct Element;
+
+    template<> struct Element<ElementType::Float32>  { using type = float;         static double toDouble(type v) { return v; } };
+    template<> struct Element<ElementType::Int16>    { using type = std::int16_t;  static double toDouble(type v) { return v; } };
+    template<> struct Element<ElementType::UInt16>   { using type = std::uint16_t; static double toDouble(type v) { return v; } };
+    template<> struct Element<ElementType::Int8>     { using type = std::int8_t;   static double toDouble(type v) { return v; } };
+    template<> struct Element<ElementType::UInt8>    { using type = std::uint8_t;  static double toDouble(type v) { return v; } };
+
+    // bfloat16 holds the upper 16 bits of an IEEE float
+    template<> struct Element<ElementType::BFloat16>
+    {
+        using type = std::uint16_t;
+        static double toDouble(type v)
+        {
+            const std::uint32_t bits = static_cast<std::uint32_t>(v) << 16;
+            float result;
+            std::memcpy(&result, &bits, sizeof(result));
+            return result;
+        }
+    };
+
+    template<ElementType E>
+    void addRowScalar(const void* row, double* sums, double* sumOfSquares, std::uint32_t* nonZeroCounts, std::size_t count)
+    {
+        using T = typename Element<E>::type;
+        const T* values = static_cast<const T*>(row);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            const double value = Element<E>::toDouble(values[i]);
+            sums[i] += value;
+            sumOfSquares[i] += value * value;
+            nonZeroCounts[i] += (value != 0.0);
+        }
+    }
+
+#ifdef CDE_X86_KERNELS
+
+    // AVX2: widen 8 elements to floats, then add them as two groups of 4 doubles
+
+    template<ElementType E> CDE_TARGET("avx2") __m256 load8(const void* values);
+
+    template<> CDE_TARGET("avx2") __m256 load8<ElementType::Float32>(const void* values)
+    {
+        return _mm256_loadu_ps(static_cast<const float*>(values));
+    }
+    template<> CDE_TARGET("avx2") __m256 load8<ElementType::Int16>(const void* values)
+    {
+        return _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_loadu_si128(static_cast<const __m128i*>(values))));
+    }
+    template<> CDE_TARGET("avx2") __m256 load8<ElementType::UInt16>(const void* values)
+    {
+        return _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(_mm_loadu_si128(static_cast<const __m128i*>(values))));
+    }
+    template<> CDE_TARGET("avx2") __m256 load8<ElementType::Int8>(const void* values)
+    {
+        return _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(_mm_loadl_epi64(static_cast<const __m128i*>(values))));
+    }
+    template<> CDE_TARGET("avx2") __m256 load8<ElementType::UInt8>(const void* values)
+    {
+        return _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64(static_cast<const __m128i*>(values))));
+    }
+    template<> CDE_TARGET("avx2") __m256 load8<ElementType::BFloat16>(const void* values)
+    {
+        return _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_cvtepu16_epi32(_mm_loadu_si128(static_cast<const __m128i*>(values))), 16));
+    }
+
+    CDE_TARGET("avx2") void addDoubles(double* accumulator, __m256d values)
+    {
+        _mm256_storeu_pd(accumulator, _mm256_add_pd(_mm256_loadu_pd(accumulator), values));
+    }
+
+    template<ElementType E>
+    CDE_TARGET("avx2") void addRowAVX2(const void* row, double* sums, double* sumOfSquares, std::uint32_t* nonZeroCounts, std::size_t count)
+    {
+        using T = typename Element<E>::type;
+        const T* values = static_cast<const T*>(row);
+        const __m256 zero = _mm256_setzero_ps();
+        std::size_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            const __m256 v = load8<E>(values + i);
+            const __m256d low = _mm256_cvtps_pd(_mm256_castps256_ps128(v));
+            const __m256d high = _mm256_cvtps_pd(_mm256_extractf128_ps(v, 1));
+            addDoubles(sums + i, low);
+            addDoubles(sums + i + 4, high);
+            addDoubles(sumOfSquares + i, _mm256_mul_pd(low, low));
+            addDoubles(sumOfSquares + i + 4, _mm256_mul_pd(high, high));
+
+            // non-zero lanes compare to all ones, i.e. -1, so subtracting the mask counts them
+            const __m256i nonZero = _mm256_castps_si256(_mm256_cmp_ps(v, zero, _CMP_NEQ_UQ));
+            __m256i* counts = reinterpret_cast<__m256i*>(nonZeroCounts + i);
+            _mm256_storeu_si256(counts, _mm256_sub_epi32(_mm256_loadu_si256(counts), nonZero));
+        }
+        addRowScalar<E>(values + i, sums + i, sumOfSquares + i, nonZeroCounts + i, count - i);
+    }
+
+    // AVX-512: widen 16 elements to floats, then add them as two groups of 8 doubles
+
+    template<ElementType E> CDE_TARGET("avx512f") __m512 load16(const void* values);
+
+    template<> CDE_TARGET("avx512f") __m512 load16<ElementType::Float32>(const void* values)
+    {
+        return _mm512_loadu_ps(values);
+    }
+    template<> CDE_TARGET("avx512f") __m512 load16<ElementType::Int16>(const void* values)
+    {
+        return _mm512_cvtepi32_ps(_mm512_cvtepi16_epi32(_mm256_loadu_si256(static_cast<const __m256i*>(values))));
+    }
+    template<> CDE_TARGET("avx512f") __m512 load16<ElementType::UInt16>(const void* values)
+    {
+        return _mm512_cvtepi32_ps(_mm512_cvtepu16_epi32(_mm256_loadu_si256(static_cast<const __m256i*>(values))));
+    }
+    template<> CDE_TARGET("avx512f") __m512 load16<ElementType::Int8>(const void* values)
+    {
+        return _mm512_cvtepi32_ps(_mm512_cvtepi8_epi32(_mm_loadu_si128(static_cast<const __m128i*>(values))));
+    }
+    template<> CDE_TARGET("avx512f") __m512 load16<ElementType::UInt8>(const void* values)
+    {
+        return _mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(_mm_loadu_si128(static_cast<const __m128i*>(values))));
+    }
+    template<> CDE_TARGET("avx512f") __m512 load16<ElementType::BFloat16>(const void* values)
+    {
+        return _mm512_castsi512_ps(_mm512_slli_epi32(_mm512_cvtepu16_epi32(_mm256_loadu_si256(static_cast<const __m256i*>(values))), 16));
+    }
+
+    CDE_TARGET("avx512f") void addDoubles(double* accumulator, __m512d values)
+    {
+        _mm512_storeu_pd(accumulator, _mm512_add_pd(_mm512_loadu_pd(accumulator), values));
+    }
+
+    // GCC 12 reports the deliberately undefined pass-through operand of the AVX-512 conversion intrinsics as maybe uninitialized
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+    template<ElementType E>
+    CDE_TARGET("avx512f") void addRowAVX512(const void* row, double* sums, double* sumOfSquares, std::uint32_t* nonZeroCounts, std::size_t count)
+    {
+        using T = typename Element<E>::type;
+        const T* values = static_cast<const T*>(row);
+        const __m512 zero = _mm512_setzero_ps();
+        const __m512i one = _mm512_set1_epi32(1);
+        std::size_t i = 0;
+        for (; i + 16 <= count; i += 16)
+        {
+            const __m512 v = load16<E>(values + i);
+            const __m512d low = _mm512_cvtps_pd(_mm512_castps512_ps256(v));
+            const __m512d high = _mm512_cvtps_pd(_mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(v), 1)));
+            addDoubles(sums + i, low);
+            addDoubles(sums + i + 8, high);
+            addDoubles(sumOfSquares + i, _mm512_mul_pd(low, low));
+            addDoubles(sumOfSquares + i + 8, _mm512_mul_pd(high, high));
+
+            const __mmask16 nonZero = _mm512_cmp_ps_mask(v, zero, _CMP_NEQ_UQ);
+            const __m512i counts = _mm512_loadu_si512(nonZeroCounts + i);
+            _mm512_storeu_si512(nonZeroCounts + i, _mm512_mask_add_epi32(counts, nonZero, counts, one));
+        }
+        addRowScalar<E>(values + i, sums + i, sumOfSquares + i, nonZeroCounts + i, count - i);
+    }
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+#endif
+
+    template<ElementType E>
+    AddRowFunction selectAddRow(InstructionSet instructionSet)
+    {
+#ifdef CDE_X86_KERNELS
+        switch (instructionSet)
+        {
+        case InstructionSet::AVX512: return &addRowAVX512<E>;
+        case InstructionSet::AVX2:   return &addRowAVX2<E>;
+        default: break;
+        }
+#endif
+        return &addRowScalar<E>;
+    }
+
+    InstructionSet queryInstructionSet()
+    {
+#ifdef CDE_X86_KERNELS
+#if defined(_MSC_VER) && !defined(__clang__)
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7)
+            return InstructionSet::Scalar;
+
+        __cpuid(info, 1);
+        const bool osxsave = (info[2] & (1 << 27)) != 0;
+        const bool avx = (info[2] & (1 << 28)) != 0;
+        if (!osxsave || !avx)
+            return InstructionSet::Scalar;
+
+        const unsigned long long xcr0 = _xgetbv(0);
+        __cpuidex(info, 7, 0);
+        const bool avx2 = (info[1] & (1 << 5)) != 0;
+        const bool avx512f = (info[1] & (1 << 16)) != 0;
+
+        if (avx512f && ((xcr0 & 0xE6) == 0xE6))
+            return InstructionSet::AVX512;
+        if (avx2 && ((xcr0 & 0x6) == 0x6))
+            return InstructionSet::AVX2;
+#else
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f"))
+            return InstructionSet::AVX512;
+        if (__builtin_cpu_supports("avx2"))
+            return InstructionSet::AVX2;
+#endif
+#endif
+        return InstructionSet::Scalar;
+    }
+}
+
+InstructionSet detectInstructionSet()
+{
+    static const InstructionSet instructionSet = queryInstructionSet();
+    return instructionSet;
+}
+
+AddRowFunction selectAddRowFunction(ElementType elementType)
+{
+    const InstructionSet instructionSet = detectInstructionSet();
+    switch (elementType)
+    {
+    case ElementType::Float32:  return selectAddRow<ElementType::Float32>(instructionSet);
+    case ElementType::Int16:    return selectAddRow<ElementType::Int16>(instructionSet);
+    case ElementType::UInt16:   return selectAddRow<ElementType::UInt16>(instructionSet);
+    case ElementType::Int8:     return selectAddRow<ElementType::Int8>(instructionSet);
+    case ElementType::UInt8:    return selectAddRow<ElementType::UInt8>(instructionSet);
+    case ElementType::BFloat16: return selectAddRow<ElementType::BFloat16>(instructionSet);
+    }
+    return &addRowScalar<ElementType::Float32>;
+}
+
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace cde {
+
+/** Storage types Points::visitData dispatches to */
+enum class ElementType { Float32, Int16, UInt16, Int8, UInt8, BFloat16 };
+
+/** Instruction sets the row kernels are compiled for, detected once at runtime */
+enum class InstructionSet { Scalar, AVX2, AVX512 };
+
+/**
+ * Adds count contiguous elements starting at row to the accumulators: the values to sums, their squares to sumOfSquares,
+ * and one to nonZeroCounts for every non-zero value
+ */
+using AddRowFunction = void (*)(const void* row, double* sums, double* sumOfSquares, std::uint32_t* nonZeroCounts, std::size_t count);
+
+/** Returns the widest instruction set supported by both the build and the CPU we are running on */
+InstructionSet detectInstructionSet();
+
+/** Returns the add-row kernel for the given storage type, picked for the detected instruction set */
+AddRowFunction selectAddRowFunction(ElementType elementType);
+
+/** Maps a Points storage type onto its ElementType; the only 16-bit non-integral storage type is bfloat16 */
+template<typename T>
+constexpr ElementType elementTypeOf()
+{
+    if constexpr (std::is_same_v<T, float>)
+        return ElementType::Float32;
+    else if constexpr (std::is_same_v<T, std::int16_t>)
+        return ElementType::Int16;
+    else if constexpr (std::is_same_v<T, std::uint16_t>)
+        return ElementType::UInt16;
+    else if constexpr (std::is_same_v<T, std::int8_t>)
+        return ElementType::Int8;
+    else if constexpr (std::is_same_v<T, std::uint8_t>)
+        return ElementType::UInt8;
+    else
+    {
+        static_assert(sizeof(T) == 2 && !std::is_integral_v<T>, "unsupported Points element type");
+        return ElementType::BFloat16;
+    }
+}
+
+}
@@ -1,29 +1,229 @@
 #include "SortFilterProxyModel.h"
 
+#include "QTableItemModel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+#if defined(__cpp_lib_parallel_algorithm)
+#include <execution>
+#endif
+
 namespace cde {
 
+namespace {
+    const QString NOT_AVAILABLE = "N/A";
+
+    // filter texts with any of these are matched as a regular expression, other texts, such as versioned IDs, literally
+    const QRegularExpression REGEXP_SYNTAX("[\\\\^$|?*+()\\[\\]{}]");
+
+    /** Sort key of a cell: "N/A" sorts first, then numbers, then strings and then every other value */
+    enum class KeyKind : std::uint8_t { NotAvailable, Number, String, Other };
+
+    /** The value a cell of the source model is displayed with, the info columns hold it in a map by role */
+    QVariant displayValue(const QTableItemModel::Column& cells, std::size_t row)
+    {
+        QVariant value = cells.value(row);
+        if (value.metaType().id() == QMetaType::QVariantMap)
+            return value.toMap().value(QString::number(Qt::DisplayRole));
+        return value;
+    }
+}
+
 SortFilterProxyModel::SortFilterProxyModel(QObject* parent)
     :QSortFilterProxyModel(parent)
+    , m_filterIndexValid(false)
+    , m_acceptedRowsValid(false)
+    , m_sortRanksColumn(-1)
 {
     m_nameRegExpFilter.setPatternOptions(QRegularExpression::CaseInsensitiveOption);
 }
 
-bool SortFilterProxyModel::filterAcceptsRow(int sourceRow, const QModelIndex& sourceParent) const
+void SortFilterProxyModel::setSourceModel(QAbstractItemModel* model)
 {
+    if (sourceModel())
+    {
+        disconnect(sourceModel(), nullptr, this, SLOT(clearSortRanks()));
+        disconnect(sourceModel(), nullptr, this, SLOT(clearFilterIndex()));
+        disconnect(sourceModel(), nullptr, this, SLOT(sourceDataChanged(QModelIndex, QModelIndex, QList<int>)));
+    }
+
+    // connected before the base class connects its own slots, so the ranks and the ID index are cleared before the proxy sorts or filters again
+    if (model)
+    {
+        connect(model, &QAbstractItemModel::modelAboutToBeReset, this, &SortFilterProxyModel::clearSortRanks);
+        connect(model, &QAbstractItemModel::layoutAboutToBeChanged, this, &SortFilterProxyModel::clearSortRanks);
+        connect(model, &QAbstractItemModel::rowsAboutToBeInserted, this, &SortFilterProxyModel::clearSortRanks);
+        connect(model, &QAbstractItemModel::rowsAboutToBeRemoved, this, &SortFilterProxyModel::clearSortRanks);
+        connect(model, &QAbstractItemModel::columnsAboutToBeInserted, this, &SortFilterProxyModel::clearSortRanks);
+        connect(model, &QAbstractItemModel::columnsAboutToBeRemoved, this, &SortFilterProxyModel::clearSortRanks);
+
+        connect(model, &QAbstractItemModel::modelAboutToBeReset, this, &SortFilterProxyModel::clearFilterIndex);
+        connect(model, &QAbstractItemModel::layoutAboutToBeChanged, this, &SortFilterProxyModel::clearFilterIndex);
+        connect(model, &QAbstractItemModel::rowsAboutToBeInserted, this, &SortFilterProxyModel::clearFilterIndex);
+        connect(model, &QAbstractItemModel::rowsAboutToBeRemoved, this, &SortFilterProxyModel::clearFilterIndex);
+        connect(model, &QAbstractItemModel::columnsAboutToBeInserted, this, &SortFilterProxyModel::clearFilterIndex);
+        connect(model, &QAbstractItemModel::columnsAboutToBeRemoved, this, &SortFilterProxyModel::clearFilterIndex);
 
+        connect(model, &QAbstractItemModel::dataChanged, this, &SortFilterProxyModel::sourceDataChanged);
+    }
+    clearSortRanks();
+    clearFilterIndex();
+    QSortFilterProxyModel::setSourceModel(model);
+}
+
+void SortFilterProxyModel::clearSortRanks()
+{
+    m_sortRanksColumn = -1;
+    m_sortRanks.clear();
+}
+
+void SortFilterProxyModel::clearFilterIndex()
+{
+    m_filterIndexValid = false;
+    m_acceptedRowsValid = false;
+}
+
+void SortFilterProxyModel::sourceDataChanged(const QModelIndex& topLeft, const QModelIndex& bottomRight, const QList<int>& roles)
+{
+    clearSortRanks();
+
+    if (!m_filterIndexValid || (topLeft.column() > 0))
+        return;
+    if (!roles.isEmpty() && !roles.contains(Qt::DisplayRole) && !roles.contains(Qt::EditRole))
+        return;
+
+    // check state changes also report the first column, the index only has to be rebuilt when an ID really changed
     QAbstractItemModel* model = sourceModel();
-    QModelIndex source_index = model->index(sourceRow, 0, sourceParent);
-    QVariant value = model->data(source_index);
-    QString qs = value.toString();
+    const int lastRow = std::min(bottomRight.row(), static_cast<int>(m_filterIndex.size()) - 1);
+    for (int row = std::max(topLeft.row(), 0); row <= lastRow; ++row)
+    {
+        if (model->data(model->index(row, 0)).toString().toLower() != m_filterIndex.id(row))
+        {
+            clearFilterIndex();
+            return;
+        }
+    }
+}
 
-    if (!m_nameRegExpFilter.pattern().isEmpty())
+bool SortFilterProxyModel::updateSortRanks(int column) const
+{
+    if (column == m_sortRanksColumn)
+        return true;
+
+    const auto* model = qobject_cast<const QTableItemModel*>(sourceModel());
+    if ((model == nullptr) || (sortRole() != Qt::DisplayRole) || (column < 0) || (column >= model->columnCount()))
+        return false;
+
+    const QTableItemModel::Column& cells = model->column(column);
+    const std::uint32_t numRows = static_cast<std::uint32_t>(model->rowCount());
+
+    // the typed keys are gathered once, so the comparisons of the sort do not go through QVariant
+    std::vector<KeyKind> kinds(numRows);
+    std::vector<double> numbers(numRows);
+    #pragma omp parallel for schedule(static)
+    for (std::ptrdiff_t row = 0; row < static_cast<std::ptrdiff_t>(numRows); ++row)
     {
-        if (!qs.contains(m_nameRegExpFilter))
-            return false;
+        numbers[row] = cells.number(row);
+        if (!std::isnan(numbers[row]))
+            kinds[row] = KeyKind::Number;
+        else if (cells.string(row).isNull())
+            kinds[row] = (displayValue(cells, row).toString() == NOT_AVAILABLE) ? KeyKind::NotAvailable : KeyKind::Other;
+        else
+            kinds[row] = (cells.string(row) == NOT_AVAILABLE) ? KeyKind::NotAvailable : KeyKind::String;
     }
+
+    const Qt::CaseSensitivity caseSensitivity = sortCaseSensitivity();
+    const bool localeAware = isSortLocaleAware();
+    const auto less = [&kinds, &numbers, &cells, caseSensitivity, localeAware](std::uint32_t left, std::uint32_t right)
+    {
+        if (kinds[left] != kinds[right])
+            return kinds[left] < kinds[right];
+        switch (kinds[left])
+        {
+        case KeyKind::Number:
+            return numbers[left] < numbers[right];
+        case KeyKind::String:
+            return localeAware ? (cells.string(left).localeAwareCompare(cells.string(right)) < 0)
+                               : (cells.string(left).compare(cells.string(right), caseSensitivity) < 0);
+        case KeyKind::Other:
+            return QVariant::compare(displayValue(cells, left), displayValue(cells, right)) == QPartialOrdering::Less;
+        default:
+            return false;
+        }
+    };
+
+    std::vector<std::uint32_t> order(numRows);
+    std::iota(order.begin(), order.end(), 0u);
+#if defined(__cpp_lib_parallel_algorithm)
+    std::stable_sort(std::execution::par, order.begin(), order.end(), less);
+#else
+    std::stable_sort(order.begin(), order.end(), less);
+#endif
+
+    m_sortRanks.resize(numRows);
+    for (std::uint32_t position = 0; position < numRows; ++position)
+        m_sortRanks[order[position]] = position;
+    m_sortRanksColumn = column;
     return true;
 }
 
+void SortFilterProxyModel::updateAcceptedRows() const
+{
+    QAbstractItemModel* model = sourceModel();
+    const std::size_t numRows = model ? static_cast<std::size_t>(model->rowCount()) : 0;
+
+    if (!m_filterIndexValid)
+    {
+        std::vector<QString> ids(numRows);
+        if (const auto* tableModel = qobject_cast<const QTableItemModel*>(model); tableModel && (tableModel->columnCount() > 0))
+        {
+            const QTableItemModel::Column& cells = tableModel->column(0);
+            #pragma omp parallel for schedule(static)
+            for (std::ptrdiff_t row = 0; row < static_cast<std::ptrdiff_t>(numRows); ++row)
+                ids[row] = cells.string(row).isNull() ? displayValue(cells, row).toString() : cells.string(row);
+        }
+        else
+        {
+            for (std::size_t row = 0; row < numRows; ++row)
+                ids[row] = model->data(model->index(static_cast<int>(row), 0)).toString();
+        }
+        m_filterIndex.build(ids);
+        m_filterIndexValid = true;
+        m_acceptedRows.assign(numRows, 0);
+        m_matchedRows.clear();
+    }
+
+    // only the rows of the previous filter are cleared, so a new filter costs time in the number of matches
+    for (std::uint32_t row : m_matchedRows)
+        m_acceptedRows[row] = 0;
+
+    const QString pattern = m_nameRegExpFilter.pattern();
+    const QStringList ids = idListFromText(pattern);
+    if (!ids.isEmpty())
+        m_matchedRows = m_filterIndex.matchingAny(ids);
+    else if (!pattern.contains(REGEXP_SYNTAX))
+        m_matchedRows = m_filterIndex.containing(pattern);
+    else
+        m_matchedRows = m_filterIndex.matching(m_nameRegExpFilter);
+
+    for (std::uint32_t row : m_matchedRows)
+        m_acceptedRows[row] = 1;
+    m_acceptedRowsValid = true;
+}
+
+bool SortFilterProxyModel::filterAcceptsRow(int sourceRow, const QModelIndex& sourceParent) const
+{
+    if (m_nameRegExpFilter.pattern().isEmpty())
+        return true;
+
+    if (!m_acceptedRowsValid)
+        updateAcceptedRows();
+
+    return (static_cast<std::size_t>(sourceRow) < m_acceptedRows.size()) && m_acceptedRows[sourceRow];
+}
+
 bool SortFilterProxyModel::filterAcceptsColumn(int source_column, const QModelIndex& source_parent) const
 {
     return true;
@@ -31,6 +231,10 @@ bool SortFilterProxyModel::filterAcceptsColumn(int source_column, const QModelIn
 
 bool SortFilterProxyModel::lessThan(const QModelIndex& source_left, const QModelIndex& source_right) const
 {
+    // the rows of a QTableItemModel are compared by their precomputed positions in the sorted column
+    if ((source_left.column() == source_right.column()) && updateSortRanks(source_left.column()))
+        return m_sortRanks[source_left.row()] < m_sortRanks[source_right.row()];
+
     QAbstractItemModel* model = sourceModel();
     QVariant left_value = model->data(source_left);
     QVariant right_value = model->data(source_right);
@@ -43,8 +247,9 @@ bool SortFilterProxyModel::lessThan(const QModelIndex& source_left, const QModel
 
 void SortFilterProxyModel::nameFilterChanged(const QString& text)
 {
-    m_nameRegExpFilter.setPattern(text);
-    invalidate();
+    m_nameRegExpFilter.setPattern(text.trimmed());
+    m_acceptedRowsValid = false;
+    invalidateFilter();
 }
 
 }
@@ -2,6 +2,11 @@
 #include <QSortFilterProxyModel>
 #include <QRegularExpression>
 
+#include "IdFilterIndex.h"
+
+#include <cstdint>
+#include <vector>
+
 namespace cde {
 
 class SortFilterProxyModel : public QSortFilterProxyModel
@@ -11,6 +16,8 @@ class SortFilterProxyModel : public QSortFilterProxyModel
 public:
     SortFilterProxyModel(QObject* parent = nullptr);
 
+    void setSourceModel(QAbstractItemModel* sourceModel) override;
+
 protected:
     bool filterAcceptsRow(int sourceRow, const QModelIndex& sourceParent) const override;
     bool filterAcceptsColumn(int source_column, const QModelIndex& source_parent) const override;
@@ -19,8 +26,31 @@ protected:
 public slots:
     void nameFilterChanged(const QString& text);
 
+private:
+    /** Sorts the rows of a column of a QTableItemModel source by their typed values once, returns false for other sources */
+    bool updateSortRanks(int column) const;
+
+    /** Rebuilds the ID index when the IDs changed and marks the source rows matching the filter text */
+    void updateAcceptedRows() const;
+
+private slots:
+    void clearSortRanks();
+    void clearFilterIndex();
+    void sourceDataChanged(const QModelIndex& topLeft, const QModelIndex& bottomRight, const QList<int>& roles);
+
 private:
     QRegularExpression	m_nameRegExpFilter;
+
+    // index of the IDs in the first column, built on the first filtering after the source model was built
+    mutable IdFilterIndex               m_filterIndex;
+    mutable bool                        m_filterIndexValid;
+    mutable bool                        m_acceptedRowsValid;
+    mutable std::vector<char>           m_acceptedRows;
+    mutable std::vector<std::uint32_t>  m_matchedRows;
+
+    // position of every source row in the ascending order of m_sortRanksColumn, valid until the source data changes
+    mutable int                         m_sortRanksColumn;
+    mutable std::vector<std::uint32_t>  m_sortRanks;
 };
 
 }
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "ClusterStatistics.h"
+
+namespace cde {
+
+/**
+ * Compressed sparse row (CSR) copy of a row-major point matrix.
+ * Only non-zero values are stored, as float, which represents every Points storage type exactly.
+ */
+struct SparseMatrix
+{
+    std::size_t                 numRows = 0;
+    std::size_t                 numColumns = 0;
+    std::vector<std::size_t>    rowOffsets;     /** numRows + 1 offsets into columnIndices and values */
+    std::vector<std::uint32_t>  columnIndices;
+    std::vector<float>          values;
+
+    std::size_t nonZeros() const { return values.size(); }
+
+    /** Builds the CSR representation of a contiguous row-major array */
+    template<typename T>
+    static SparseMatrix fromDense(const T* data, std::size_t rows, std::size_t columns);
+};
+
+/** Estimates the fraction of non-zero values of a row-major array from (at most) sampleRows evenly spaced rows */
+template<typename T>
+double estimateDensity(const T* data, std::size_t rows, std::size_t columns, std::size_t sampleRows = 1024)
+{
+    if (rows == 0 || columns == 0)
+        return 1.0;
+
+    const std::size_t numSamples = std::min(rows, sampleRows);
+    const std::size_t stride = rows / numSamples;
+    std::size_t nonZeros = 0;
+    for (std::size_t sample = 0; sample < numSamples; ++sample)
+    {
+        const T* row = data + (sample * stride * columns);
+        for (std::size_t column = 0; column < columns; ++column)
+        {
+            if (static_cast<float>(row[column]) != 0.0f)
+                ++nonZeros;
+        }
+    }
+    return static_cast<double>(nonZeros) / (static_cast<double>(numSamples) * columns);
+}
+
+template<typename T>
+SparseMatrix SparseMatrix::fromDense(const T* data, std::size_t rows, std::size_t columns)
+{
+    SparseMatrix result;
+    result.numRows = rows;
+    result.numColumns = columns;
+    result.rowOffsets.assign(rows + 1, 0);
+
+    const std::ptrdiff_t numRows = static_cast<std::ptrdiff_t>(rows);
+
+    // first pass counts the non-zeros per row, second pass fills in the rows at their prefix-summed offsets
+    #pragma omp parallel for schedule(static)
+    for (std::ptrdiff_t row = 0; row < numRows; ++row)
+    {
+        const T* values = data + (row * columns);
+        std::size_t count = 0;
+        for (std::size_t column = 0; column < columns; ++column)
+        {
+            if (static_cast<float>(values[column]) != 0.0f)
+                ++count;
+        }
+        result.rowOffsets[row + 1] = count;
+    }
+
+    for (std::size_t row = 0; row < rows; ++row)
+        result.rowOffsets[row + 1] += result.rowOffsets[row];
+
+    result.columnIndices.resize(result.rowOffsets[rows]);
+    result.values.resize(result.rowOffsets[rows]);
+
+    #pragma omp parallel for schedule(static)
+    for (std::ptrdiff_t row = 0; row < numRows; ++row)
+    {
+        const T* values = data + (row * columns);
+        std::size_t offset = result.rowOffsets[row];
+        for (std::size_t column = 0; column < columns; ++column)
+        {
+            const float value = static_cast<float>(values[column]);
+            if (value != 0.0f)
+            {
+                result.columnIndices[offset] = static_cast<std::uint32_t>(column);
+                result.values[offset] = value;
+                ++offset;
+            }
+        }
+    }
+    return result;
+}
+
+/**
+ * Computes the per-cluster sums, sums of squares and non-zero counts from the non-zeros of a sparse matrix only.
+ * Clusters are processed in parallel, every cluster adds its rows into its own accumulator row.
+ *
+ * @param matrix Sparse copy of the parent points
+ * @param clusters Clusters of the cluster dataset, indices refer to rows of the matrix
+ * @param statistics Accumulators, reset by this function
+ * @param progress Called with the cluster index once a cluster has been processed, returns false to skip the remaining clusters
+ */
+template<typename ClusterVector, typename ProgressFunction>
+void accumulateSparseClusterRows(const SparseMatrix& matrix, const ClusterVector& clusters, ClusterStatistics& statistics, ProgressFunction progress)
+{
+    const std::ptrdiff_t numClusters = static_cast<std::ptrdiff_t>(clusters.size());
+    const std::size_t numDimensions = matrix.numColumns;
+    statistics.reset(numClusters, numDimensions);
+
+    std::atomic<bool> stopped = false;
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (std::ptrdiff_t clusterIdx = 0; clusterIdx < numClusters; ++clusterIdx)
+    {
+        if (stopped)
+            continue;
+
+        const auto& clusterIndices = clusters[clusterIdx].getIndices();
+        double* sums = statistics.sums.data() + (clusterIdx * numDimensions);
+        double* sumOfSquares = statistics.sumOfSquares.data() + (clusterIdx * numDimensions);
+        std::uint32_t* nonZeroCounts = statistics.nonZeroCounts.data() + (clusterIdx * numDimensions);
+        for (auto row : clusterIndices)
+        {
+            const std::size_t end = matrix.rowOffsets[row + 1];
+            for (std::size_t i = matrix.rowOffsets[row]; i < end; ++i)
+            {
+                const std::uint32_t column = matrix.columnIndices[i];
+                const double value = matrix.values[i];
+                sums[column] += value;
+                sumOfSquares[column] += value * value;
+                ++nonZeroCounts[column];
+            }
+        }
+        statistics.clusterSizes[clusterIdx] = clusterIndices.size();
+        if (!progress(clusterIdx))
+            stopped = true;
+    }
+}
+
+}
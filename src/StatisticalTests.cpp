@@ -0,0 +1,138 @@
+#include "StatisticalTests.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+
+#if defined(__cpp_lib_parallel_algorithm)
+#include <execution>
+#endif
+
+namespace cde {
+
+namespace {
+
+    constexpr int MAX_ITERATIONS = 200;
+    constexpr double EPSILON = 1e-15;
+    constexpr double TINY = 1e-300;
+
+    // continued fraction of the incomplete beta function, evaluated with the modified Lentz method
+    double incompleteBetaContinuedFraction(double a, double b, double x)
+    {
+        const double qab = a + b;
+        const double qap = a + 1.0;
+        const double qam = a - 1.0;
+
+        double c = 1.0;
+        double d = 1.0 - (qab * x / qap);
+        if (std::fabs(d) < TINY)
+            d = TINY;
+        d = 1.0 / d;
+        double h = d;
+
+        for (int m = 1; m <= MAX_ITERATIONS; ++m)
+        {
+            const int m2 = 2 * m;
+            double aa = m * (b - m) * x / ((qam + m2) * (a + m2));
+            d = 1.0 + (aa * d);
+            if (std::fabs(d) < TINY)
+                d = TINY;
+            c = 1.0 + (aa / c);
+            if (std::fabs(c) < TINY)
+                c = TINY;
+            d = 1.0 / d;
+            h *= d * c;
+
+            aa = -(a + m) * (qab + m) * x / ((a + m2) * (qap + m2));
+            d = 1.0 + (aa * d);
+            if (std::fabs(d) < TINY)
+                d = TINY;
+            c = 1.0 + (aa / c);
+            if (std::fabs(c) < TINY)
+                c = TINY;
+            d = 1.0 / d;
+            const double delta = d * c;
+            h *= delta;
+            if (std::fabs(delta - 1.0) < EPSILON)
+                break;
+        }
+        return h;
+    }
+}
+
+double regularizedIncompleteBeta(double a, double b, double x)
+{
+    if (std::isnan(x) || x < 0.0 || x > 1.0)
+        return std::numeric_limits<double>::quiet_NaN();
+    if (x == 0.0 || x == 1.0)
+        return x;
+
+    const double logFront = std::lgamma(a + b) - std::lgamma(a) - std::lgamma(b) + (a * std::log(x)) + (b * std::log1p(-x));
+    const double front = std::exp(logFront);
+
+    // the continued fraction converges quickly for x < (a + 1) / (a + b + 2), use the symmetry relation otherwise
+    if (x < (a + 1.0) / (a + b + 2.0))
+        return front * incompleteBetaContinuedFraction(a, b, x) / a;
+    return 1.0 - (front * incompleteBetaContinuedFraction(b, a, 1.0 - x) / b);
+}
+
+double studentTTwoSidedPValue(double t, double degreesOfFreedom)
+{
+    if (std::isnan(t) || !(degreesOfFreedom > 0.0))
+        return std::numeric_limits<double>::quiet_NaN();
+    if (std::isinf(t))
+        return 0.0;
+    return regularizedIncompleteBeta(0.5 * degreesOfFreedom, 0.5, degreesOfFreedom / (degreesOfFreedom + (t * t)));
+}
+
+WelchTestResult welchTTest(double mean1, double variance1, std::size_t count1, double mean2, double variance2, std::size_t count2)
+{
+    const double NaN = std::numeric_limits<double>::quiet_NaN();
+    if (count1 < 2 || count2 < 2 || std::isnan(variance1) || std::isnan(variance2))
+        return { NaN, NaN, NaN };
+
+    const double error1 = variance1 / count1;
+    const double error2 = variance2 / count2;
+    const double standardErrorSquared = error1 + error2;
+    if (!(standardErrorSquared > 0.0))
+        return { NaN, NaN, NaN };
+
+    const double t = (mean1 - mean2) / std::sqrt(standardErrorSquared);
+    const double degreesOfFreedom = (standardErrorSquared * standardErrorSquared) / (((error1 * error1) / (count1 - 1)) + ((error2 * error2) / (count2 - 1)));
+    return { t, degreesOfFreedom, studentTTwoSidedPValue(t, degreesOfFreedom) };
+}
+
+std::vector<double> benjaminiHochberg(const std::vector<double>& pValues)
+{
+    std::vector<double> result(pValues.size(), std::numeric_limits<double>::quiet_NaN());
+
+    std::vector<std::uint32_t> order;
+    order.reserve(pValues.size());
+    for (std::size_t i = 0; i < pValues.size(); ++i)
+    {
+        if (!std::isnan(pValues[i]))
+            order.push_back(static_cast<std::uint32_t>(i));
+    }
+
+    const auto ascending = [&pValues](std::uint32_t lhs, std::uint32_t rhs) { return pValues[lhs] < pValues[rhs]; };
+#if defined(__cpp_lib_parallel_algorithm)
+    std::sort(std::execution::par_unseq, order.begin(), order.end(), ascending);
+#else
+    std::sort(order.begin(), order.end(), ascending);
+#endif
+
+    // step-up: walk from the largest p-value down, keeping the running minimum of p * m / rank
+    const double numTests = static_cast<double>(order.size());
+    double runningMinimum = 1.0;
+    for (std::size_t rank = order.size(); rank > 0; --rank)
+    {
+        const std::uint32_t index = order[rank - 1];
+        runningMinimum = std::min(runningMinimum, pValues[index] * numTests / rank);
+        result[index] = runningMinimum;
+    }
+    return result;
+}
+
+}
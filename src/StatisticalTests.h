@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace cde {
+
+/** Regularized incomplete beta function I_x(a, b) */
+double regularizedIncompleteBeta(double a, double b, double x);
+
+/** Two-sided p-value of a Student t statistic with (possibly non-integral) degrees of freedom */
+double studentTTwoSidedPValue(double t, double degreesOfFreedom);
+
+struct WelchTestResult
+{
+    double t;                   /** NaN when both groups have zero variance */
+    double degreesOfFreedom;
+    double pValue;              /** two-sided, NaN when t is */
+};
+
+/** Welch's unequal variances t-test from the sufficient statistics (mean, sample variance, count) of two groups */
+WelchTestResult welchTTest(double mean1, double variance1, std::size_t count1, double mean2, double variance2, std::size_t count2);
+
+/**
+ * Benjamini-Hochberg adjusted p-values, in the order of pValues.
+ * NaN p-values are not counted as tests and stay NaN.
+ */
+std::vector<double> benjaminiHochberg(const std::vector<double>& pValues);
+
+}
@@ -0,0 +1,228 @@
+#include "StatisticsDiskCache.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace cde {
+
+namespace {
+    constexpr char FILE_MAGIC[8] = { 'C', 'D', 'E', 'S', 'T', 'A', 'T', 'S' };
+    constexpr std::uint32_t FILE_VERSION = 1;
+    constexpr std::size_t SECTION_ALIGNMENT = 64;
+    const QString FILE_SUFFIX = ".cdestats";
+
+    struct FileHeader
+    {
+        char            magic[8];
+        std::uint32_t   version;
+        std::uint32_t   reserved;
+        std::uint64_t   numClusters;
+        std::uint64_t   numDimensions;
+    };
+
+    /** Byte offsets of the arrays in a cache file */
+    struct FileLayout
+    {
+        std::size_t sums;
+        std::size_t sumOfSquares;
+        std::size_t nonZeroCounts;
+        std::size_t clusterSizes;
+        std::size_t size;
+
+        FileLayout(std::size_t numClusters, std::size_t numDimensions)
+        {
+            const auto align = [](std::size_t offset) { return (offset + SECTION_ALIGNMENT - 1) / SECTION_ALIGNMENT * SECTION_ALIGNMENT; };
+            const std::size_t numValues = numClusters * numDimensions;
+            sums = align(sizeof(FileHeader));
+            sumOfSquares = align(sums + (numValues * sizeof(double)));
+            nonZeroCounts = align(sumOfSquares + (numValues * sizeof(double)));
+            clusterSizes = align(nonZeroCounts + (numValues * sizeof(std::uint32_t)));
+            size = clusterSizes + (numClusters * sizeof(std::uint64_t));
+        }
+    };
+
+    constexpr std::size_t HASH_BLOCK_SIZE = 1 << 20;
+    constexpr std::uint64_t HASH_MULTIPLIER = 0x9E3779B97F4A7C15ull;
+
+    std::uint64_t mix(std::uint64_t value)
+    {
+        value ^= value >> 33;
+        value *= 0xFF51AFD7ED558CCDull;
+        value ^= value >> 33;
+        value *= 0xC4CEB9FE1A85EC53ull;
+        value ^= value >> 33;
+        return value;
+    }
+
+    std::uint64_t hashBlock(const unsigned char* data, std::size_t size)
+    {
+        std::uint64_t hash = size * HASH_MULTIPLIER;
+        std::size_t i = 0;
+        for (; i + sizeof(std::uint64_t) <= size; i += sizeof(std::uint64_t))
+        {
+            std::uint64_t word;
+            std::memcpy(&word, data + i, sizeof(word));
+            hash = (hash ^ mix(word)) * HASH_MULTIPLIER;
+        }
+        for (; i < size; ++i)
+            hash = (hash ^ data[i]) * HASH_MULTIPLIER;
+        return mix(hash);
+    }
+}
+
+std::uint64_t contentHash(const void* data, std::size_t size)
+{
+    const auto* bytes = static_cast<const unsigned char*>(data);
+    const std::ptrdiff_t numBlocks = static_cast<std::ptrdiff_t>((size + HASH_BLOCK_SIZE - 1) / HASH_BLOCK_SIZE);
+    std::vector<std::uint64_t> blockHashes(numBlocks);
+
+    #pragma omp parallel for schedule(static)
+    for (std::ptrdiff_t block = 0; block < numBlocks; ++block)
+    {
+        const std::size_t offset = block * HASH_BLOCK_SIZE;
+        blockHashes[block] = hashBlock(bytes + offset, std::min(HASH_BLOCK_SIZE, size - offset));
+    }
+
+    std::uint64_t hash = mix(size);
+    for (auto blockHash : blockHashes)
+        hash = mix(hash ^ blockHash) * HASH_MULTIPLIER;
+    return hash;
+}
+
+StatisticsDiskCache::StatisticsDiskCache()
+    : _maximumSize(0)
+{
+}
+
+void StatisticsDiskCache::setDirectory(const QString& directory)
+{
+    QMutexLocker locker(&_mutex);
+    _directory = directory;
+}
+
+void StatisticsDiskCache::setMaximumSize(qint64 bytes)
+{
+    {
+        QMutexLocker locker(&_mutex);
+        _maximumSize = bytes;
+    }
+    evict();
+}
+
+bool StatisticsDiskCache::isEnabled() const
+{
+    QMutexLocker locker(&_mutex);
+    return (_maximumSize > 0) && !_directory.isEmpty();
+}
+
+QString StatisticsDiskCache::filePath(const QByteArray& key) const
+{
+    return QDir(_directory).filePath(QString::fromLatin1(key.toHex()) + FILE_SUFFIX);
+}
+
+bool StatisticsDiskCache::load(const QByteArray& key, std::size_t numClusters, std::size_t numDimensions, ClusterStatistics& statistics)
+{
+    QMutexLocker locker(&_mutex);
+    if ((_maximumSize <= 0) || _directory.isEmpty())
+        return false;
+
+    QFile file(filePath(key));
+    if (!file.open(QIODevice::ReadWrite))
+        return false;
+
+    const FileLayout layout(numClusters, numDimensions);
+    if (static_cast<std::size_t>(file.size()) != layout.size)
+        return false;
+
+    const uchar* data = file.map(0, file.size());
+    if (data == nullptr)
+        return false;
+
+    FileHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    const bool valid = (std::memcmp(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC)) == 0) && (header.version == FILE_VERSION)
+        && (header.numClusters == numClusters) && (header.numDimensions == numDimensions);
+    if (valid)
+    {
+        statistics.reset(numClusters, numDimensions);
+        const std::size_t numValues = numClusters * numDimensions;
+        std::memcpy(statistics.sums.data(), data + layout.sums, numValues * sizeof(double));
+        std::memcpy(statistics.sumOfSquares.data(), data + layout.sumOfSquares, numValues * sizeof(double));
+        std::memcpy(statistics.nonZeroCounts.data(), data + layout.nonZeroCounts, numValues * sizeof(std::uint32_t));
+        const auto* clusterSizes = reinterpret_cast<const std::uint64_t*>(data + layout.clusterSizes);
+        std::copy(clusterSizes, clusterSizes + numClusters, statistics.clusterSizes.begin());
+    }
+    file.unmap(const_cast<uchar*>(data));
+
+    // the modification time orders the files for eviction
+    if (valid)
+        file.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+    return valid;
+}
+
+void StatisticsDiskCache::store(const QByteArray& key, const ClusterStatistics& statistics)
+{
+    {
+        QMutexLocker locker(&_mutex);
+        if ((_maximumSize <= 0) || _directory.isEmpty() || !QDir().mkpath(_directory))
+            return;
+
+        const FileLayout layout(statistics.numClusters, statistics.numDimensions);
+        if (static_cast<qint64>(layout.size) > _maximumSize)
+            return;
+
+        FileHeader header = {};
+        std::memcpy(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC));
+        header.version = FILE_VERSION;
+        header.numClusters = statistics.numClusters;
+        header.numDimensions = statistics.numDimensions;
+
+        std::vector<std::uint64_t> clusterSizes(statistics.clusterSizes.cbegin(), statistics.clusterSizes.cend());
+        const std::size_t numValues = statistics.numClusters * statistics.numDimensions;
+
+        // written to a temporary file that replaces the cache file once complete, so a reader never sees a partial file
+        QSaveFile file(filePath(key));
+        if (!file.open(QIODevice::WriteOnly))
+            return;
+
+        const auto write = [&file](std::size_t offset, const void* values, std::size_t size)
+        {
+            const QByteArray padding(static_cast<qsizetype>(offset - file.pos()), '\0');
+            file.write(padding);
+            file.write(static_cast<const char*>(values), static_cast<qint64>(size));
+        };
+        write(0, &header, sizeof(header));
+        write(layout.sums, statistics.sums.data(), numValues * sizeof(double));
+        write(layout.sumOfSquares, statistics.sumOfSquares.data(), numValues * sizeof(double));
+        write(layout.nonZeroCounts, statistics.nonZeroCounts.data(), numValues * sizeof(std::uint32_t));
+        write(layout.clusterSizes, clusterSizes.data(), clusterSizes.size() * sizeof(std::uint64_t));
+        if (!file.commit())
+            return;
+    }
+    evict();
+}
+
+void StatisticsDiskCache::evict()
+{
+    QMutexLocker locker(&_mutex);
+    if (_directory.isEmpty())
+        return;
+
+    QFileInfoList files = QDir(_directory).entryInfoList({ "*" + FILE_SUFFIX }, QDir::Files, QDir::Time);   // most recently used first
+    qint64 totalSize = 0;
+    for (const QFileInfo& fileInfo : files)
+    {
+        totalSize += fileInfo.size();
+        if (totalSize > _maximumSize)
+            QFile::remove(fileInfo.absoluteFilePath());
+    }
+}
+
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "ClusterStatistics.h"
+
+#include <QByteArray>
+#include <QMutex>
+#include <QString>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace cde {
+
+/**
+ * Directory of binary files holding per-cluster statistics, so statistics that were not saved with a project do not
+ * have to be aggregated again. A file holds the sums, sums of squares, non-zero counts and cluster sizes as flat
+ * 64-byte aligned arrays behind a small header, and is memory-mapped when read.
+ * Files are named after their key; the least recently used files are removed once the directory exceeds the maximum size.
+ * All functions can be called from any thread.
+ */
+class StatisticsDiskCache
+{
+public:
+    StatisticsDiskCache();
+
+    void setDirectory(const QString& directory);
+
+    /** Maximum total size of the cache files in bytes, 0 disables the cache */
+    void setMaximumSize(qint64 bytes);
+
+    bool isEnabled() const;
+
+    /** Reads the statistics stored under key, returns false when there are none or they do not match the expected size */
+    bool load(const QByteArray& key, std::size_t numClusters, std::size_t numDimensions, ClusterStatistics& statistics);
+
+    /** Stores the statistics under key and evicts the least recently used files when the cache grew too large */
+    void store(const QByteArray& key, const ClusterStatistics& statistics);
+
+private:
+    QString filePath(const QByteArray& key) const;
+    void evict();
+
+    mutable QMutex  _mutex;
+    QString         _directory;
+    qint64          _maximumSize;
+};
+
+/** 64-bit hash of a block of memory, the memory is hashed in parallel in fixed-size blocks */
+std::uint64_t contentHash(const void* data, std::size_t size);
+
+}